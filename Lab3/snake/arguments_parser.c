@@ -51,6 +51,9 @@ init_arguments()
 	args->scorefile_path = NULL;
 	args->disable_top_scores = 0;
 	args->max_stored_scores = -1;
+	args->headless = 0;
+	args->ticks = DEFAULT_HEADLESS_TICKS;
+	args->seed = 1;
 
 	return (args);
 }
@@ -114,6 +117,13 @@ display_help(char *executable)
 			"-F, --disable-top-scores");
 	printf("\t%-*sSet maximum amount of scores to be recorded (Def: %d)\n",
 			OPT_WIDTH, "-M, --max-stored-scores <scores>", DEFAULT_MAX_STORED_SCORES);
+	puts("\nHeadless (no terminal, the snake plays by itself):");
+	printf("\t%-*sRun without a terminal and print a summary\n", OPT_WIDTH,
+			"-x, --headless");
+	printf("\t%-*sSet number of ticks to simulate (Def: %d)\n", OPT_WIDTH,
+			"-n, --ticks <ticks>", DEFAULT_HEADLESS_TICKS);
+	printf("\t%-*sSet seed of the random generator (Def: 1)\n", OPT_WIDTH,
+			"-r, --seed <seed>");
 	printf("\n\t%-*sDisplay this help\n", OPT_WIDTH, "-h, --help");
 }
 
@@ -144,10 +154,13 @@ parse_arguments(int argc, char *argv[])
 		{"scorefile-path", required_argument, NULL, 'f'},
 		{"disable-top-scores", no_argument, NULL, 'F'},
 		{"max-stored-scores", required_argument, NULL, 'M'},
+		{"headless", no_argument, NULL, 'x'},
+		{"ticks", required_argument, NULL, 'n'},
+		{"seed", required_argument, NULL, 'r'},
 		{"help", no_argument, NULL, 'h'},
 		{0, 0, 0, 0}
 	};
-	while ((op = getopt_long(argc, argv, ":tH:W:o:s:m:S:2d:D:e:p:P:E:c:Ckf:FM:h",
+	while ((op = getopt_long(argc, argv, ":tH:W:o:s:m:S:2d:D:e:p:P:E:c:Ckf:FM:xn:r:h",
 					long_options, NULL)) != -1)
 	{
 		switch (op)
@@ -214,6 +227,15 @@ parse_arguments(int argc, char *argv[])
 			case 'M':
 				args->max_stored_scores = atoi(optarg);
 				break;
+			case 'x':
+				args->headless = 1;
+				break;
+			case 'n':
+				args->ticks = atol(optarg);
+				break;
+			case 'r':
+				args->seed = strtoul(optarg, NULL, 10);
+				break;
 			case 'h':
 				display_help(argv[0]);
 				delete_arguments(args);
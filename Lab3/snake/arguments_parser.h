@@ -33,6 +33,9 @@ typedef struct arguments_s
 	int disable_top_scores;
 	char *scorefile_path;
 	int max_stored_scores;
+	int headless;
+	long ticks;
+	unsigned int seed;
 } arguments_t;
 
 /*
@@ -57,6 +57,10 @@
 /* Map change */
 #define DEFAULT_SCORE_STEP_MAP_CHANGE 200
 
+/* Headless mode */
+#define DEFAULT_HEADLESS_TICKS 100000
+#define AUTOPILOT_TURN_CHANCE 10  /* 1/X chances of turning on a clear way */
+
 /* Score marks CSV */
 #define DEFAULT_CSV_FILE ".local/share/snake_scores.csv"  /* Relative path from the home */
 #define DEFAULT_MAX_STORED_SCORES 10
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2020 Esteban López Rodríguez <gnu_stallman@protonmail.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "engine.h"
+#include "config.h"
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Moves the clock the temporal items are scheduled against
+ */
+static void
+update_clock(engine_t *engine)
+{
+	if (engine->simulated_clock)
+		engine->field->now = engine->elapsed_ms / 1000;
+	else
+		engine->field->now = time(NULL);
+}
+
+engine_t*
+init_engine(arguments_t *args, int simulated_clock)
+{
+	engine_t *engine = malloc(sizeof(engine_t));
+
+	engine->args = args;
+	engine->field = init_field(args->height, args->width, args->permill_obstacles);
+	engine->snake = init_snake(engine->field, HEAD);
+	engine->snake2 = args->two_players ? init_snake(engine->field, HEAD2) : NULL;
+	engine->last_moved = NULL;
+	add_food(engine->field);
+
+	engine->score = 0;
+	engine->score2 = 0;
+	engine->score_last_change = 0;
+	engine->delay = args->starting_delay;
+	engine->simulated_clock = simulated_clock;
+	engine->elapsed_ms = 0;
+	engine->food_eaten = 0;
+	update_clock(engine);
+
+	return (engine);
+}
+
+int
+step_engine(engine_t *engine, input_t input)
+{
+	arguments_t *args = engine->args;
+	field_t *field = engine->field;
+	snake_t *snakex;
+	unsigned int *scorex;
+	int alive = 1;
+
+	if (input.who == AC_PLAYER)
+		engine->snake->direction = input.direction;
+	else if (input.who == AC_PLAYER2 && engine->snake2)
+		engine->snake2->direction = input.direction;
+
+	/* Move the snake */
+	for (int i = 0; i <= 1 && alive; i++)
+	{
+		if (i == 0) /* Player turn */
+		{
+			/* Skip to player2 if the action was of him */
+			if (input.who == AC_PLAYER2)
+				continue;
+			snakex = engine->snake;
+			scorex = &engine->score;
+		}
+		else /* Player2 turn */
+		{
+			if (!args->two_players || input.who == AC_PLAYER)
+				break;
+			snakex = engine->snake2;
+			scorex = &engine->score2;
+		}
+
+		engine->last_moved = snakex;
+		switch (advance(field, snakex))
+		{
+			case EMPTY:
+				break;
+			case SNAKE:
+			case HEAD:
+			case HEAD2:
+			case BORDER:
+			case OBSTACLE:
+				alive = 0;
+				break;
+			case FOOD:
+				add_food(field);
+				*scorex += POINTS_FOOD;
+				engine->food_eaten++;
+
+				/* Delay reduction */
+				if (engine->delay > args->minimum_delay)
+					engine->delay -= args->step_delay;
+				else
+					engine->delay = args->minimum_delay;
+
+				/* Items generation */
+				if (rand() % args->probability_shortener == 0)
+					add_temp_item(field, SHORTENER, args->duration_shortener);
+				if (rand() % args->probability_decelerator == 0)
+					add_temp_item(field, DECELERATOR, args->duration_decelerator);
+				if (rand() % args->probability_extra_points == 0)
+					add_temp_item(field, EXTRA_POINTS, args->duration_extra_points);
+				break;
+			case SHORTENER:
+				*scorex += POINTS_SHORTENER;
+				break;
+			case DECELERATOR:
+				*scorex += POINTS_DECELERATOR;
+				engine->delay = args->starting_delay;
+				break;
+			case EXTRA_POINTS:
+				*scorex += POINTS_EXTRA_POINTS;
+				break;
+		}
+
+		/* Map change */
+		if (!args->disable_map_change &&
+				*scorex >= engine->score_last_change + args->score_step_map_change)
+		{
+			change_obstacles(field);
+			engine->score_last_change = *scorex;
+		}
+	}
+
+	/* Time passes until the next tick */
+	engine->elapsed_ms += engine->delay;
+	update_clock(engine);
+	remove_expired_items(field);
+
+	return (alive);
+}
+
+void
+delete_engine(engine_t *engine)
+{
+	delete_snake(engine->snake);
+	if (engine->snake2)
+		delete_snake(engine->snake2);
+	delete_field(engine->field);
+
+	free(engine);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2020 Esteban López Rodríguez <gnu_stallman@protonmail.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "arguments_parser.h"
+#include "field.h"
+#include "snake.h"
+
+/* Who gave the input of a tick */
+typedef enum {AC_TIMEOUT, AC_PLAYER, AC_PLAYER2} action_who_t;
+
+typedef struct
+{
+	action_who_t who;
+	direction_t direction;  /* New direction of who, if anybody */
+} input_t;
+
+typedef struct
+{
+	arguments_t *args;
+	field_t *field;
+	snake_t *snake, *snake2;  /* snake2 is NULL with one player */
+	snake_t *last_moved;  /* The one that died when the game ends */
+	unsigned int score, score2, score_last_change;
+	int delay;  /* Milliseconds until the next tick */
+	int simulated_clock;  /* Items expire by summed delays, not wall time */
+	long long elapsed_ms;
+	unsigned long food_eaten;
+} engine_t;
+
+
+/*
+ * Initialize the field, snakes and food of a new game. With
+ * simulated_clock the game doesn't depend on wall time at all
+ */
+engine_t*
+init_engine(arguments_t *args, int simulated_clock);
+
+/*
+ * Run one tick: apply the input, move the snakes, score and spawn
+ * items. Returns 0 if a snake died
+ */
+int
+step_engine(engine_t *engine, input_t input);
+
+/*
+ * Deallocate the engine with its field and snakes
+ */
+void
+delete_engine(engine_t *engine);
+
+#endif /* ENGINE_H */
@@ -17,19 +17,20 @@
 
 // modification of header location for CPE2600 - DER 9/10/2023 
 #include "field.h"
+#include <string.h>
 
 /*
  * Add an item to a temp_item_list_t
  */
 static void
-_add_temp_item(temp_item_list_t *til, coord_t y, coord_t x, time_t duration)
+_add_temp_item(temp_item_list_t *til, coord_t y, coord_t x, time_t destruction)
 {
 	temp_item_t *new_item = malloc(sizeof(temp_item_t));
 	temp_item_t *aux;
 
 	new_item->y = y;
 	new_item->x = x;
-	new_item->scheduled_destruction = time(NULL) + duration;
+	new_item->scheduled_destruction = destruction;
 	new_item->next = NULL;
 
 	if (*til)
@@ -44,19 +45,17 @@ _add_temp_item(temp_item_list_t *til, coord_t y, coord_t x, time_t duration)
 }
 
 /*
- * Get (*y, *x) coordinates of an expired item. Set them to -1 if no
+ * Get (*y, *x) coordinates of an item expired by now. Set them to -1 if no
  * expired items are available. It also deallocates the item from the til
  */
 static void
-get_expired_item(temp_item_list_t *til, coord_t *y, coord_t *x)
+get_expired_item(temp_item_list_t *til, time_t now, coord_t *y, coord_t *x)
 {
 	temp_item_t *curr, *prev;
-	time_t now;
 
 	*y = *x = -1;
 	if (*til)
 	{
-		now = time(NULL);
 		prev = NULL;
 		curr = *til;
 		while (curr)
@@ -72,6 +71,7 @@ get_expired_item(temp_item_list_t *til, coord_t *y, coord_t *x)
 				free(curr);
 				break;
 			}
+			prev = curr;
 			curr = curr->next;
 		}
 	}
@@ -91,6 +91,44 @@ delete_temp_item_list_content(temp_item_list_t til)
 	}
 }
 
+/*
+ * Adds the cell at offset to the set of EMPTY cells
+ */
+static void
+add_free_cell(field_t *field, int offset)
+{
+	field->free_index[offset] = field->n_free;
+	field->free_cells[field->n_free++] = offset;
+}
+
+/*
+ * Takes the cell at offset out of the set of EMPTY cells, moving the last
+ * one of the set to its place
+ */
+static void
+remove_free_cell(field_t *field, int offset)
+{
+	int position = field->free_index[offset];
+	int last = field->free_cells[--field->n_free];
+
+	field->free_cells[position] = last;
+	field->free_index[last] = position;
+	field->free_index[offset] = -1;
+}
+
+void
+set_cell(field_t *field, coord_t y, coord_t x, cell_t type)
+{
+	int offset = (field->origin - field->cells) + y * field->stride + x;
+
+	if (field->cells[offset] == EMPTY && type != EMPTY)
+		remove_free_cell(field, offset);
+	else if (field->cells[offset] != EMPTY && type == EMPTY)
+		add_free_cell(field, offset);
+
+	field->cells[offset] = (uint8_t)type;
+}
+
 /*
  * Stores in (*y, *x) the coordinate of a random empty cell. Returns 0 if
  * no empty cells are found
@@ -98,31 +136,15 @@ delete_temp_item_list_content(temp_item_list_t til)
 static int
 get_random_empty_cell(field_t *field, coord_t *y, coord_t *x)
 {
-	coord_t empty_cells[(field->width - 2) * (field->height - 2)][2];
-	int i, j, size = 0;
+	int offset;
 
-	/* Find all the EMPTY cells and store their coordinates in empty_cells */
-	for (i = 1; i <= field->height - 2; i++)
-	{
-		for (j = 1; j <= field->width - 2; j++)
-		{
-			if (field->matrix[i][j] == EMPTY)
-			{
-				empty_cells[size][0] = i;
-				empty_cells[size][1] = j;
-				size++;
-			}
-		}
-	}
+	if (field->n_free == 0)
+		return (0);
 
-	if (size > 0)
-	{
-		i = rand() % size;  /* Choose a random item of empty_cells */
-		*y = empty_cells[i][0];
-		*x = empty_cells[i][1];
-		return (1);
-	}
-	return (0);
+	offset = field->free_cells[rand() % field->n_free];
+	*y = offset / field->stride - 1;
+	*x = offset % field->stride - 1;
+	return (1);
 }
 
 /*
@@ -136,7 +158,7 @@ add_obstacle(field_t *field)
 
 	if (get_random_empty_cell(field, &y, &x))
 	{
-		field->matrix[y][x] = OBSTACLE;
+		set_cell(field, y, x, OBSTACLE);
 		return (1);
 	}
 	return (0);
@@ -148,17 +170,19 @@ add_obstacle(field_t *field)
 static int
 clear_obstacles(field_t *field)
 {
-	int i, j, n_obstacles = 0;
+	const uint8_t *row, *found;
+	int i, n_obstacles = 0;
 
-	for (i = 1; i < field->height; i++)
+	/* Bytes per cell let memchr skip the rest of the row */
+	for (i = 1; i < field->height - 1; i++)
 	{
-		for (j = 1; j < field->width; j++)
+		row = field_row(field, i);
+		found = row + 1;
+		while ((found = memchr(found, OBSTACLE, row + field->width - 1 - found)))
 		{
-			if (field->matrix[i][j] == OBSTACLE)
-			{
-				field->matrix[i][j] = EMPTY;
-				n_obstacles++;
-			}
+			set_cell(field, i, found - row, EMPTY);
+			n_obstacles++;
+			found++;
 		}
 	}
 
@@ -174,13 +198,13 @@ has_exit(field_t *field, coord_t y, coord_t x)
 {
 	int free_sides = 4;
 
-	if (field->matrix[y-1][x] == BORDER || field->matrix[y-1][x] == OBSTACLE)
+	if (get_cell(field, y-1, x) == BORDER || get_cell(field, y-1, x) == OBSTACLE)
 		free_sides--;
-	if (field->matrix[y+1][x] == BORDER || field->matrix[y+1][x] == OBSTACLE)
+	if (get_cell(field, y+1, x) == BORDER || get_cell(field, y+1, x) == OBSTACLE)
 		free_sides--;
-	if (field->matrix[y][x-1] == BORDER || field->matrix[y][x-1] == OBSTACLE)
+	if (get_cell(field, y, x-1) == BORDER || get_cell(field, y, x-1) == OBSTACLE)
 		free_sides--;
-	if (field->matrix[y][x+1] == BORDER || field->matrix[y][x+1] == OBSTACLE)
+	if (get_cell(field, y, x+1) == BORDER || get_cell(field, y, x+1) == OBSTACLE)
 		free_sides--;
 
 	return (free_sides >= 2);
@@ -198,31 +222,24 @@ init_field(int height, int width, int permill_obstacles)
 	field->width = width;
 	field->height = height;
 
-	/* Matrix (map) */
-	field->matrix = malloc(sizeof(cell_t*) * height);
-	for (i = 0; i < height; i++)
+	/* Matrix (map), surrounded by a guard ring of border */
+	field->stride = width + 2;
+	field->cells = malloc((height + 2) * field->stride);
+	memset(field->cells, BORDER, (height + 2) * field->stride);
+	field->origin = field->cells + field->stride + 1;
+
+	/* Every cell inside the border starts EMPTY */
+	field->free_cells = malloc(sizeof(int) * (height - 2) * (width - 2));
+	field->free_index = malloc(sizeof(int) * (height + 2) * field->stride);
+	memset(field->free_index, -1, sizeof(int) * (height + 2) * field->stride);
+	field->n_free = 0;
+	for (i = 1; i < height - 1; i++)
 	{
-		field->matrix[i] = malloc(sizeof(cell_t) * width);
-		for (j = 0; j < width; j++)
-			field->matrix[i][j] = EMPTY;
+		memset(field->origin + i * field->stride + 1, EMPTY, width - 2);
+		for (j = 1; j < width - 1; j++)
+			add_free_cell(field, (field->origin - field->cells) + i * field->stride + j);
 	}
 
-	/* North border placing */
-	for (i = 0; i < width; i++)
-		field->matrix[0][i] = BORDER;
-
-	/* South border placing */
-	for (i = 0; i < width; i++)
-		field->matrix[height - 1][i] = BORDER;
-
-	/* West border placing */
-	for (i = 0; i < height; i++)
-		field->matrix[i][0] = BORDER;
-
-	/* East border placing */
-	for (i = 0; i < height; i++)
-		field->matrix[i][width - 1] = BORDER;
-
 	/* Obstacles placing */
 	number_obstacles = (height-2) * (width-2) * permill_obstacles / 1000;
 	for (i = 0; i < number_obstacles; i++)
@@ -230,6 +247,7 @@ init_field(int height, int width, int permill_obstacles)
 
 	/* List of temporal items */
 	field->til = NULL;
+	field->now = time(NULL);
 
 	return (field);
 }
@@ -254,7 +272,7 @@ add_food(field_t *field)
 	{
 		if (get_random_empty_cell(field, &y, &x) && has_exit(field, y, x))
 		{
-			field->matrix[y][x] = FOOD;
+			set_cell(field, y, x, FOOD);
 			return (1);
 		}
 	}
@@ -271,8 +289,8 @@ add_temp_item(field_t *field, cell_t type, time_t duration)
 	{
 		if (get_random_empty_cell(field, &y, &x) && has_exit(field, y, x))
 		{
-			field->matrix[y][x] = type;
-			_add_temp_item(&field->til, y, x, duration);
+			set_cell(field, y, x, type);
+			_add_temp_item(&field->til, y, x, field->now + duration);
 			return (1);
 		}
 	}
@@ -296,17 +314,18 @@ void
 remove_expired_items(field_t *field)
 {
 	coord_t y, x;
+	cell_t type;
 	int keep = 1;
 
 	while (keep)
 	{
-		get_expired_item(&field->til, &y, &x);
+		get_expired_item(&field->til, field->now, &y, &x);
 		if (y != -1 && x != -1)
 		{
 			/* Check that the item hasn't been eaten already */
-			if (field->matrix[y][x] != SNAKE && field->matrix[y][x] != HEAD &&
-					field->matrix[y][x] != HEAD2 && field->matrix[y][x] != OBSTACLE)
-				field->matrix[y][x] = EMPTY;
+			type = get_cell(field, y, x);
+			if (type != SNAKE && type != HEAD && type != HEAD2 && type != OBSTACLE)
+				set_cell(field, y, x, EMPTY);
 		}
 		else
 			keep = 0;
@@ -316,9 +335,9 @@ remove_expired_items(field_t *field)
 void
 delete_field(field_t *field)
 {
-	for (int i = 0; i < field->height; i++)
-		free(field->matrix[i]);
-	free(field->matrix);
+	free(field->cells);
+	free(field->free_cells);
+	free(field->free_index);
 
 	delete_temp_item_list_content(field->til);
 
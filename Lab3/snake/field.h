@@ -18,6 +18,7 @@
 #ifndef FIELD_H
 #define FIELD_H
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -48,11 +49,43 @@ typedef temp_item_t* temp_item_list_t;
 typedef struct
 {
 	int width, height;
-	cell_t **matrix;  /* [height][width] */
+	int stride;        /* Bytes from one row to the next */
+	uint8_t *cells;    /* One byte per cell, with a guard ring of BORDER */
+	uint8_t *origin;   /* Cell (0, 0) inside cells */
+	int *free_cells;   /* Offsets in cells of every EMPTY cell, unordered */
+	int *free_index;   /* Position of each cell in free_cells, or -1 */
+	int n_free;        /* Used entries of free_cells */
 	temp_item_list_t til;
+	time_t now;  /* Clock the temporal items are scheduled against */
 } field_t;
 
 
+/*
+ * Returns the type of the cell at (y, x). The guard ring lets y and x go
+ * one cell past the map on every side
+ */
+static inline cell_t
+get_cell(const field_t *field, coord_t y, coord_t x)
+{
+	return ((cell_t)field->origin[y * field->stride + x]);
+}
+
+/*
+ * Sets the type of the cell at (y, x), keeping the set of EMPTY cells
+ * up to date
+ */
+void
+set_cell(field_t *field, coord_t y, coord_t x, cell_t type);
+
+/*
+ * Returns row y of the map indexed by x, for scans that read whole rows
+ */
+static inline const uint8_t*
+field_row(const field_t *field, coord_t y)
+{
+	return (field->origin + y * field->stride);
+}
+
 /*
  * Initialize a field with empty (incl. borders) matrix
  */
@@ -86,7 +119,7 @@ void
 prolong_temp_items(field_t *field, time_t extra_seconds);
 
 /*
- * Take away expired items from the map
+ * Take away items expired by field->now from the map
  */
 void
 remove_expired_items(field_t *field);
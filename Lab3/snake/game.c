@@ -19,6 +19,7 @@
 #include "config.h"
 #include "field.h"
 #include "snake.h"
+#include "engine.h"
 #include "arguments_parser.h"
 #include "score_file.h"
 #include <ncurses.h>
@@ -161,15 +162,17 @@ static void
 redraw_game(WINDOW *w_game, field_t *field,
 		direction_t dir, direction_t dir2)
 {
+	const uint8_t *row;
 	int i, j;
 
 	werase(w_game);
 
 	for (i = 0; i < field->height; i++)
 	{
+		row = field_row(field, i);
 		for (j = 0; j < field->width; j++)
 		{
-			switch (field->matrix[i][j])
+			switch (row[j])
 			{
 				case EMPTY:
 					break;
@@ -178,11 +181,11 @@ redraw_game(WINDOW *w_game, field_t *field,
 					break;
 				case HEAD:
 				case HEAD2:
-					if (field->matrix[i][j] == HEAD)
+					if (row[j] == HEAD)
 						wattron(w_game, COLOR_PAIR(PAIR_HEAD));
 					else
 						wattron(w_game, COLOR_PAIR(PAIR_HEAD2));
-					switch (field->matrix[i][j] == HEAD ? dir : dir2)
+					switch (row[j] == HEAD ? dir : dir2)
 					{
 						case NORTH:
 							mvwaddch(w_game, i, j, '^');
@@ -196,7 +199,7 @@ redraw_game(WINDOW *w_game, field_t *field,
 						case SOUTH:
 							mvwaddch(w_game, i, j, 'v');
 					}
-					if (field->matrix[i][j] == HEAD)
+					if (row[j] == HEAD)
 						wattroff(w_game, COLOR_PAIR(PAIR_HEAD));
 					else
 						wattroff(w_game, COLOR_PAIR(PAIR_HEAD2));
@@ -318,15 +321,10 @@ static void
 start(arguments_t *args)
 {
 	WINDOW *w_score, *w_game, *w_keys;
-	field_t *field;
-	snake_t *snake, *snake2, *snakex = NULL;
-	unsigned int w_game_y, w_keys_height, score, score2, keep_mainloop, died;
-	unsigned int score_last_change;
-	unsigned int *scorex;
-	time_t delay;
-
-	/* Stores who pressed the key */
-	enum {AC_TIMEOUT, AC_PLAYER, AC_PLAYER2} action_who;
+	engine_t *engine;
+	unsigned int w_game_y, w_keys_height, keep_mainloop, died;
+	int delay;
+	input_t input;
 
 	set_curses_properties();
 
@@ -344,171 +342,90 @@ start(arguments_t *args)
 		w_keys = newwin(w_keys_height, WIDTH_W_KEYS, LINES/2 - w_keys_height/2,
 				COLS - WIDTH_W_KEYS - 1);
 
-	field = init_field(args->height, args->width, args->permill_obstacles);
-	snake = init_snake(field, HEAD);
-	snake2= args->two_players ? init_snake(field, HEAD2) : NULL;
-	add_food(field);
+	engine = init_engine(args, 0);
 
 	if (!args->disable_keys_help)
 		draw_keys(w_keys, args->two_players);
 
 	/* Mainloop */
-	score = 0;
-	score2 = 0;
-	score_last_change = 0;
 	died = 0;
 	keep_mainloop = 1;
-	delay = args->starting_delay;
+	delay = engine->delay;
 	timeout(delay);
 	while (keep_mainloop)
 	{
-		remove_expired_items(field);
 		if (args->two_players)
-			redraw_score(w_score, score, &score2);
+			redraw_score(w_score, engine->score, &engine->score2);
 		else
-			redraw_score(w_score, score, NULL);
-		redraw_game(w_game, field, snake->direction,
-				args->two_players ? snake2->direction : 0);
+			redraw_score(w_score, engine->score, NULL);
+		redraw_game(w_game, engine->field, engine->snake->direction,
+				args->two_players ? engine->snake2->direction : 0);
 		doupdate();
 
 		/* Get user input */
-		action_who = AC_PLAYER;
+		input.who = AC_PLAYER;
+		input.direction = engine->snake->direction;
 		switch (getch())
 		{
 			case ERR:
-				action_who = AC_TIMEOUT;
+				input.who = AC_TIMEOUT;
 				break;
 			case 'w':
 			case 'k':
-				snake->direction = NORTH;
+				input.direction = NORTH;
 				break;
 			case 'a':
 			case 'h':
-				snake->direction = WEST;
+				input.direction = WEST;
 				break;
 			case 's':
 			case 'j':
-				snake->direction = SOUTH;
+				input.direction = SOUTH;
 				break;
 			case 'd':
 			case 'l':
-				snake->direction = EAST;
+				input.direction = EAST;
 				break;
 
 				/* Keys functionality depends on two_players mode */
 			case KEY_UP:
 				if (args->two_players)
-				{
-					snake2->direction = NORTH;
-					action_who = AC_PLAYER2;
-				}
-				else
-					snake->direction = NORTH;
+					input.who = AC_PLAYER2;
+				input.direction = NORTH;
 				break;
 			case KEY_LEFT:
 				if (args->two_players)
-				{
-					snake2->direction = WEST;
-					action_who = AC_PLAYER2;
-				}
-				else
-					snake->direction = WEST;
+					input.who = AC_PLAYER2;
+				input.direction = WEST;
 				break;
 			case KEY_RIGHT:
 				if (args->two_players)
-				{
-					snake2->direction = EAST;
-					action_who = AC_PLAYER2;
-				}
-				else
-					snake->direction = EAST;
+					input.who = AC_PLAYER2;
+				input.direction = EAST;
 				break;
 			case KEY_DOWN:
 				if (args->two_players)
-				{
-					snake2->direction = SOUTH;
-					action_who = AC_PLAYER2;
-				}
-				else
-					snake->direction = SOUTH;
+					input.who = AC_PLAYER2;
+				input.direction = SOUTH;
 				break;
 			case 'p':
-				pause_game(w_game, field, delay);
+				pause_game(w_game, engine->field, delay);
 				break;
 			case 'q':
 				keep_mainloop = 0;
 		}
 
-		/* Move the snake */
-		for (int i = 0; i <= 1 && keep_mainloop; i++)
+		if (keep_mainloop && !step_engine(engine, input))
 		{
-			if (i == 0) /* Player turn */
-			{
-				/* Skip to player2 if the action was of him */
-				if (action_who == AC_PLAYER2)
-					continue;
-				snakex = snake;
-				scorex = &score;
-			}
-			else /* Player2 turn */
-			{
-				if (!args->two_players || action_who == AC_PLAYER)
-					break;
-				snakex = snake2;
-				scorex = &score2;
-			}
-
-			switch (advance(field, snakex))
-			{
-				case EMPTY:
-					break;
-				case SNAKE:
-				case HEAD:
-				case HEAD2:
-				case BORDER:
-				case OBSTACLE:
-					died = 1;
-					keep_mainloop = 0;
-					break;
-				case FOOD:
-					add_food(field);
-					*scorex += POINTS_FOOD;
-
-					/* Delay reduction */
-					if (delay > args->minimum_delay)
-						delay -= args->step_delay;
-					else
-						delay = args->minimum_delay;
-					timeout(delay);
-
-					/* Items generation */
-					if (rand() % args->probability_shortener == 0)
-						add_temp_item(field, SHORTENER, args->duration_shortener);
-					if (rand() % args->probability_decelerator == 0)
-						add_temp_item(field, DECELERATOR, args->duration_decelerator);
-					if (rand() % args->probability_extra_points == 0)
-						add_temp_item(field, EXTRA_POINTS, args->duration_extra_points);
-					break;
-				case SHORTENER:
-					*scorex += POINTS_SHORTENER;
-					break;
-				case DECELERATOR:
-					*scorex += POINTS_DECELERATOR;
-					delay = args->starting_delay;
-					timeout(delay);
-					break;
-				case EXTRA_POINTS:
-					*scorex += POINTS_EXTRA_POINTS;
-					break;
-			}
+			died = 1;
+			keep_mainloop = 0;
+		}
 
-			/* Map change */
-			if (!args->disable_map_change &&
-					*scorex >= score_last_change + args->score_step_map_change)
-			{
-				change_obstacles(field);
-				score_last_change = *scorex;
-			}
+		/* Food and decelerators change the speed */
+		if (engine->delay != delay)
+		{
+			delay = engine->delay;
+			timeout(delay);
 		}
 	}
 
@@ -520,28 +437,137 @@ start(arguments_t *args)
 	endwin();
 
 	if (args->two_players && died)
-		printf("Player %d died first\n", snakex == snake ? 1 : 2);
+		printf("Player %d died first\n", engine->last_moved == engine->snake ? 1 : 2);
 
 	if (!args->disable_top_scores)
-		score_marks(args, score, score2);
+		score_marks(args, engine->score, engine->score2);
 
 	/* Free the memory */
-	delete_snake(snake);
-	if (args->two_players)
-		delete_snake(snake2);
-	delete_field(field);
+	delete_engine(engine);
+}
 
+/*
+ * Whether a snake can move over a cell of this type without dying
+ */
+static int
+is_safe_cell(cell_t cell)
+{
+	switch (cell)
+	{
+		case EMPTY:
+		case FOOD:
+		case SHORTENER:
+		case DECELERATOR:
+		case EXTRA_POINTS:
+			return (1);
+		default:
+			return (0);
+	}
+}
+
+/*
+ * Picks a direction for an unattended snake: keeps going while the way is
+ * clear, now and then turns, and avoids cells that would kill it
+ */
+static direction_t
+autopilot(field_t *field, snake_t *snake)
+{
+	direction_t candidates[4], direction;
+	coord_t y, x;
+	int safe = 0;
+
+	next_head_position(snake, snake->direction, &y, &x);
+	if (is_safe_cell(get_cell(field, y, x)) && rand() % AUTOPILOT_TURN_CHANCE)
+		return (snake->direction);
+
+	for (direction = NORTH; direction <= SOUTH; direction++)
+	{
+		next_head_position(snake, direction, &y, &x);
+		if (is_safe_cell(get_cell(field, y, x)))
+			candidates[safe++] = direction;
+	}
+
+	/* Cornered: nowhere to go */
+	if (!safe)
+		return (snake->direction);
+
+	return (candidates[rand() % safe]);
+}
+
+/*
+ * Plays games without a terminal until args->ticks ticks have passed and
+ * prints a summary
+ */
+static void
+run_headless(arguments_t *args)
+{
+	engine_t *engine;
+	input_t input;
+	unsigned long long score_sum = 0;
+	unsigned long food_eaten = 0, games = 1;
+	unsigned int best_score = 0;
+	struct timespec begin, end;
+	double seconds;
+
+	srand(args->seed);
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	engine = init_engine(args, 1);
+	for (long tick = 0; tick < args->ticks; tick++)
+	{
+		input.who = AC_PLAYER;
+		input.direction = autopilot(engine->field, engine->snake);
+
+		if (!step_engine(engine, input))
+		{
+			/* Start over */
+			score_sum += engine->score;
+			food_eaten += engine->food_eaten;
+			if (engine->score > best_score)
+				best_score = engine->score;
+			delete_engine(engine);
+
+			engine = init_engine(args, 1);
+			games++;
+		}
+	}
+	score_sum += engine->score;
+	food_eaten += engine->food_eaten;
+	if (engine->score > best_score)
+		best_score = engine->score;
+	delete_engine(engine);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+	printf("Ticks:       %ld\n", args->ticks);
+	printf("Games:       %lu\n", games);
+	printf("Food eaten:  %lu\n", food_eaten);
+	printf("Best score:  %u\n", best_score);
+	printf("Mean score:  %.1f\n", (double)score_sum / games);
+	printf("Elapsed:     %.3f s\n", seconds);
+	printf("Ticks/s:     %.0f\n", seconds > 0 ? args->ticks / seconds : 0);
 }
 
 /*
  * Set default values in unspecified options. Also checks terminal size.
- * NEEDS INITIALIZED NCURSES
+ * NEEDS INITIALIZED NCURSES, unless headless
  */
 static void
 set_default_options(arguments_t *args)
 {
 	/* Size settings */
-	if (args->use_terminal_dimensions)
+	if (args->headless)
+	{
+		/* No terminal to follow or fit in, and only one autopilot */
+		args->use_terminal_dimensions = 0;
+		args->two_players = 0;
+		if (args->height == -1)
+			args->height = DEFAULT_W_GAME_HEIGHT;
+		if (args->width == -1)
+			args->width = DEFAULT_W_GAME_WIDTH;
+	}
+	else if (args->use_terminal_dimensions)
 	{
 		args->height = LINES - 4;
 		if (args->disable_keys_help)
@@ -558,14 +584,15 @@ set_default_options(arguments_t *args)
 	}
 
 	/* Check terminal size */
-	if (args->height + 3 > LINES)
+	if (!args->headless && args->height + 3 > LINES)
 	{
 		endwin();
 		delete_arguments(args);
 		fputs("Terminal height too small\n", stderr);
 		exit(1);
 	}
-	if (args->width + (args->disable_keys_help ? 0 : WIDTH_W_KEYS+1) + 2 > COLS)
+	if (!args->headless &&
+			args->width + (args->disable_keys_help ? 0 : WIDTH_W_KEYS+1) + 2 > COLS)
 	{
 		endwin();
 		delete_arguments(args);
@@ -628,6 +655,14 @@ main(int argc, char *argv[])
 {
 	arguments_t *args = parse_arguments(argc, argv);
 
+	if (args->headless)
+	{
+		set_default_options(args);
+		run_headless(args);
+		delete_arguments(args);
+		return (0);
+	}
+
 	srand(time(NULL));
 	initscr();
 
@@ -19,6 +19,41 @@
 #include "snake.h"
 #include <time.h>
 
+#define INITIAL_BODY_CAPACITY 16
+
+/*
+ * Returns the i-th cell of the body counting from the tail
+ */
+static body_t*
+body_cell(snake_t *snake, int i)
+{
+	int index = snake->tail + i;
+
+	/* Wrap around without a division */
+	if (index >= snake->capacity)
+		index -= snake->capacity;
+
+	return (&snake->body[index]);
+}
+
+/*
+ * Returns the head of the snake
+ */
+static body_t*
+head_cell(snake_t *snake)
+{
+	return (body_cell(snake, snake->length - 1));
+}
+
+/*
+ * Returns the cell right behind the head, or the head if it's alone
+ */
+static body_t*
+neck_cell(snake_t *snake)
+{
+	return (body_cell(snake, snake->length >= 2 ? snake->length - 2 : 0));
+}
+
 snake_t*
 init_snake(field_t *field, cell_t head_type)
 {
@@ -29,21 +64,38 @@ init_snake(field_t *field, cell_t head_type)
 	/* Random initial direction */
 	snake->direction = rand() % 4;
 
-	snake->tail = malloc(sizeof(body_t));
+	snake->capacity = INITIAL_BODY_CAPACITY;
+	snake->body = malloc(sizeof(body_t) * snake->capacity);
+	snake->tail = 0;
+	snake->length = 1;
 	/* Choose random place without direct contact with the borders */
-	snake->tail->y = (rand() % (field->height - 4)) + 2;
-	snake->tail->x = (rand() % (field->width - 4)) + 2;
-	snake->tail->next = NULL;
-	snake->neck = snake->tail;
-	snake->head = snake->tail;
+	snake->body[0].y = (rand() % (field->height - 4)) + 2;
+	snake->body[0].x = (rand() % (field->width - 4)) + 2;
 
 	/* Head */
 	snake->head_type = head_type;
-	field->matrix[snake->head->y][snake->head->x] = head_type;
+	set_cell(field, snake->body[0].y, snake->body[0].x, head_type);
 
 	return (snake);
 }
 
+/*
+ * Doubles the body, unrolling it so the tail is at the start again
+ */
+static void
+grow_body(snake_t *snake)
+{
+	body_t *body = malloc(sizeof(body_t) * snake->capacity * 2);
+
+	for (int i = 0; i < snake->length; i++)
+		body[i] = *body_cell(snake, i);
+
+	free(snake->body);
+	snake->body = body;
+	snake->capacity *= 2;
+	snake->tail = 0;
+}
+
 /*
  * Add a node in the specified (y,x) coords, reflecting change in both
  * field and snake
@@ -51,17 +103,19 @@ init_snake(field_t *field, cell_t head_type)
 static void
 append_head(field_t *field, snake_t *snake, coord_t y, coord_t x)
 {
+	body_t *head = head_cell(snake);
+
 	/* In the field */
-	field->matrix[snake->head->y][snake->head->x] = SNAKE;
-	field->matrix[y][x] = snake->head_type;
+	set_cell(field, head->y, head->x, SNAKE);
+	set_cell(field, y, x, snake->head_type);
 
 	/* In the snake */
-	snake->head->next = malloc(sizeof(body_t));
-	snake->head->next->y = y;
-	snake->head->next->x = x;
-	snake->head->next->next = NULL;
-	snake->neck = snake->head;
-	snake->head = snake->head->next;
+	if (snake->length == snake->capacity)
+		grow_body(snake);
+	snake->length++;
+	head = head_cell(snake);
+	head->y = y;
+	head->x = x;
 }
 
 /*
@@ -70,15 +124,15 @@ append_head(field_t *field, snake_t *snake, coord_t y, coord_t x)
 static void
 delete_tail(field_t *field, snake_t *snake)
 {
-	body_t *aux;
+	body_t *tail = body_cell(snake, 0);
 
 	/* In the field */
-	field->matrix[snake->tail->y][snake->tail->x] = EMPTY;
+	set_cell(field, tail->y, tail->x, EMPTY);
 
 	/* In the snake */
-	aux = snake->tail->next;
-	free(snake->tail);
-	snake->tail = aux;
+	if (++snake->tail == snake->capacity)
+		snake->tail = 0;
+	snake->length--;
 }
 
 /*
@@ -87,24 +141,11 @@ delete_tail(field_t *field, snake_t *snake)
 static void
 delete_half_snake(field_t *field, snake_t *snake)
 {
-	int snake_length = 0;
-	body_t *aux = snake->tail;
-
-	/* Measure snake lenght */
-	while (aux != snake->head)
-	{
-		snake_length++;
-		aux = aux->next;
-	}
+	/* The head doesn't count */
+	int half = (snake->length - 1) / 2;
 
-	for (int i = 0; i < snake_length/2; i++)
-	{
-		field->matrix[snake->tail->y][snake->tail->x] = EMPTY;
-
-		aux = snake->tail->next;
-		free(snake->tail);
-		snake->tail = aux;
-	}
+	for (int i = 0; i < half; i++)
+		delete_tail(field, snake);
 }
 
 /*
@@ -129,32 +170,39 @@ reverse_direction(snake_t *snake)
 	}
 }
 
-cell_t
-advance(field_t *field, snake_t *snake)
+void
+next_head_position(snake_t *snake, direction_t direction, coord_t *y, coord_t *x)
 {
-	coord_t next_y = 0, next_x = 0;
-	cell_t old_type;
+	body_t *head = head_cell(snake);
 
-	switch (snake->direction)
+	*y = head->y;
+	*x = head->x;
+
+	switch (direction)
 	{
 		case NORTH:
-			next_y = snake->head->y - 1;
-			next_x = snake->head->x;
+			(*y)--;
 			break;
 		case EAST:
-			next_y = snake->head->y;
-			next_x = snake->head->x + 1;
+			(*x)++;
 			break;
 		case WEST:
-			next_y = snake->head->y;
-			next_x = snake->head->x - 1;
+			(*x)--;
 			break;
 		case SOUTH:
-			next_y = snake->head->y + 1;
-			next_x = snake->head->x;
+			(*y)++;
 	}
+}
+
+cell_t
+advance(field_t *field, snake_t *snake)
+{
+	coord_t next_y, next_x;
+	cell_t old_type;
+
+	next_head_position(snake, snake->direction, &next_y, &next_x);
 
-	switch (old_type = field->matrix[next_y][next_x])
+	switch (old_type = get_cell(field, next_y, next_x))
 	{
 		case SHORTENER:
 			delete_half_snake(field, snake);
@@ -175,7 +223,7 @@ advance(field_t *field, snake_t *snake)
 			 * Reverse direction and advance again if hitting the neck so
 			 * the snake doesn't die if it tries to go against it
 			 */
-			if (next_y == snake->neck->y && next_x == snake->neck->x)
+			if (next_y == neck_cell(snake)->y && next_x == neck_cell(snake)->x)
 			{
 				reverse_direction(snake);
 				old_type = advance(field, snake);
@@ -191,20 +239,9 @@ advance(field_t *field, snake_t *snake)
 	return (old_type);
 }
 
-/*
- * Recursively free body from the tail
- */
-static void
-delete_body(body_t *node)
-{
-	if (node->next)
-		delete_body(node->next);
-	free(node);
-}
-
 void
 delete_snake(snake_t *snake)
 {
-	delete_body(snake->tail);
+	free(snake->body);
 	free(snake);
 }
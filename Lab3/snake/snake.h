@@ -27,13 +27,19 @@ typedef enum {NORTH, EAST, WEST, SOUTH} direction_t;
 typedef struct body_s
 {
 	coord_t y, x;
-	struct body_s *next;
 } body_t;
 
+/*
+ * The body is a ring buffer of coordinates running from the tail to the
+ * head. It doubles when full, so it is only reallocated when growing.
+ */
 typedef struct snake_s
 {
 	direction_t direction;
-	body_t *tail, *neck, *head;
+	body_t *body;
+	int capacity;  /* Allocated cells of body */
+	int tail;      /* Index of the tail in body */
+	int length;    /* Cells from the tail to the head, both included */
 	cell_t head_type;
 } snake_t;
 
@@ -44,6 +50,12 @@ typedef struct snake_s
 snake_t*
 init_snake(field_t *field, cell_t head_type);
 
+/*
+ * Store in (*y, *x) the cell the head would move to going in direction
+ */
+void
+next_head_position(snake_t *snake, direction_t direction, coord_t *y, coord_t *x);
+
 /*
  * Make the snake advance one cell in the field, return type of
  * the cell it advanced over
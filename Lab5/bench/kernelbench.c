@@ -0,0 +1,129 @@
+/**
+ * @file kernelbench.c
+ * @brief Small vector add and dot per second, through the unrolled
+ * kernel tables and through a loop over the size
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Usage: kernelbench [operations]
+ *
+ * Algorithm:
+ *  - For each size 1 to KERNEL_MAX_SIZE, run add then dot on the same
+ *    pair of vectors (default 10^7 times each), best of BENCH_REPEATS
+ *  - The loop is the one the tables replaced, a for over vecSize in a
+ *    function of its own. The kernel is looked up by size for every
+ *    operation, the way vector.c picks it once per vector
+ */
+
+#include "kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_OPERATIONS 10000000.0
+#define BENCH_REPEATS 3
+
+// Results are summed here so no operation is optimized away
+static volatile double sink;
+
+
+static double secondsSince(const struct timespec * start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+
+__attribute__((noinline))
+static void loopAdd(const double * a, const double * b, double * out, int vecSize) {
+
+    for(int i = 0; i < vecSize; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+
+__attribute__((noinline))
+static double loopDot(const double * a, const double * b, int vecSize) {
+
+    double sum = 0.0;
+
+    for(int i = 0; i < vecSize; ++i) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+
+/**
+ * Best operations per second over the repeats, add when dot is false.
+ * size is read through a volatile so neither version sees a constant
+ */
+static double opsPerSecond(bool tables, bool dot, volatile int * size, size_t ops) {
+
+    double a[KERNEL_MAX_SIZE];
+    double b[KERNEL_MAX_SIZE];
+    double out[KERNEL_MAX_SIZE];
+    double best = INFINITY;
+
+    for(int i = 0; i < KERNEL_MAX_SIZE; ++i) {
+        a[i] = i + 1.0;
+        b[i] = 0.5 * i;
+    }
+
+    for(int r = 0; r < BENCH_REPEATS; ++r) {
+        struct timespec start;
+        double total = 0.0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for(size_t op = 0; op < ops; ++op) {
+            int n = *size;
+
+            if( dot ) {
+                total += tables ? dotKernels[n](a, b) : loopDot(a, b, n);
+            } else if( tables ) {
+                addKernels[n](a, b, out);
+                total += out[0];
+            } else {
+                loopAdd(a, b, out, n);
+                total += out[0];
+            }
+        }
+
+        double seconds = secondsSince(&start);
+        best = ( seconds < best ) ? seconds : best;
+        sink += total;
+    }
+
+    return ops / best;
+}
+
+
+int main(int argc, char * argv[]) {
+
+    size_t ops = (size_t) ( ( argc > 1 ) ? atof(argv[1]) : DEFAULT_OPERATIONS );
+    volatile int size;
+
+    printf("%zu operations per size, millions per second\n", ops);
+    printf("%4s %10s %10s %8s %10s %10s %8s\n", "size", "add loop", "add table", "speedup",
+           "dot loop", "dot table", "speedup");
+
+    for(size = 1; size <= KERNEL_MAX_SIZE; ++size) {
+        double addLoop = opsPerSecond(false, false, &size, ops);
+        double addTable = opsPerSecond(true, false, &size, ops);
+        double dotLoop = opsPerSecond(false, true, &size, ops);
+        double dotTable = opsPerSecond(true, true, &size, ops);
+
+        printf("%4d %10.1f %10.1f %7.2fx %10.1f %10.1f %7.2fx\n", size, addLoop / 1e6, addTable / 1e6,
+               addTable / addLoop, dotLoop / 1e6, dotTable / 1e6, dotTable / dotLoop);
+    }
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file mathbench.c
+ * @brief Times the fastmath functions against libm, on their own and
+ * over a file-backed vector with "fastmath on" and off
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Usage: mathbench [elements]
+ *
+ * Algorithm:
+ *  - Fill an array with random doubles in a range every function takes
+ *    (default 10^7 of them)
+ *  - Time a libm loop and the fastmath function over the array, best
+ *    of BENCH_REPEATS runs each
+ *  - Write the array to a file, map it as x, and time each command
+ *    "sqrt x" ... "tanh x" through mmExecute with fastmath off and on.
+ *    Results go through TMPDIR, pointed at the benchmark's own directory
+ */
+
+#include "libminimat.h"
+#include "fastmath.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_ELEMENTS 10000000.0
+#define BENCH_REPEATS 3
+#define BENCH_PATH_LEN 256
+#define BENCH_COMMAND_LEN ( BENCH_PATH_LEN + 32 )
+
+typedef struct {
+
+    const char * name;
+    arrayFn fast;
+    double (*libm)(double);
+
+} mathCase;
+
+
+static double secondsSince(const struct timespec * start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+
+static uint64_t splitmix(uint64_t * state) {
+
+    uint64_t z = ( *state += 0x9E3779B97F4A7C15ULL );
+
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return z ^ ( z >> 31 );
+}
+
+
+static double timeLibm(double (*fn)(double), const double * in, double * out, size_t n) {
+
+    double best = INFINITY;
+
+    for(int r = 0; r < BENCH_REPEATS; ++r) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for(size_t i = 0; i < n; ++i) {
+            out[i] = fn(in[i]);
+        }
+
+        double seconds = secondsSince(&start);
+        best = ( seconds < best ) ? seconds : best;
+    }
+
+    return best;
+}
+
+
+static double timeFast(arrayFn fn, const double * in, double * out, size_t n) {
+
+    double best = INFINITY;
+
+    for(int r = 0; r < BENCH_REPEATS; ++r) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        fn(in, out, n);
+
+        double seconds = secondsSince(&start);
+        best = ( seconds < best ) ? seconds : best;
+    }
+
+    return best;
+}
+
+
+static double timeCommand(mmWorkspace * ws, const char * command) {
+
+    double best = INFINITY;
+
+    for(int r = 0; r < BENCH_REPEATS; ++r) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        if( mmExecute(ws, command) != 0 ) {
+            return NAN;
+        }
+
+        double seconds = secondsSince(&start);
+        best = ( seconds < best ) ? seconds : best;
+    }
+
+    return best;
+}
+
+
+int main(int argc, char * argv[]) {
+
+    size_t n = (size_t) ( ( argc > 1 ) ? atof(argv[1]) : DEFAULT_ELEMENTS );
+    double * in = malloc(n * sizeof(double));
+    double * out = malloc(n * sizeof(double));
+    uint64_t state = n;
+
+    if( n == 0 || in == NULL || out == NULL ) {
+        fprintf(stderr, "mathbench: not enough memory for %zu elements\n", n);
+        return 1;
+    }
+
+    // (0, 20] suits log and sqrt, and keeps exp well away from overflow
+    for(size_t i = 0; i < n; ++i) {
+        in[i] = 20.0 - ( splitmix(&state) >> 11 ) * ( 20.0 / 9007199254740992.0 );
+    }
+
+    const mathCase cases[] = {
+        { "sqrt", fastSqrt, sqrt },
+        { "exp",  fastExp,  exp },
+        { "log",  fastLog,  log },
+        { "sin",  fastSin,  sin },
+        { "cos",  fastCos,  cos },
+        { "tanh", fastTanh, tanh },
+        { "abs",  fastAbs,  fabs },
+    };
+    size_t numCases = sizeof(cases) / sizeof(cases[0]);
+
+    printf("%zu elements in memory\n", n);
+    printf("%6s %10s %10s %8s\n", "", "libm s", "fast s", "speedup");
+
+    for(size_t c = 0; c < numCases; ++c) {
+        double libmSeconds = timeLibm(cases[c].libm, in, out, n);
+        double fastSeconds = timeFast(cases[c].fast, in, out, n);
+
+        printf("%6s %10.3f %10.3f %7.2fx\n", cases[c].name, libmSeconds, fastSeconds, libmSeconds / fastSeconds);
+    }
+
+    char benchDir[BENCH_PATH_LEN];
+    char path[BENCH_PATH_LEN + 16];
+    char command[BENCH_COMMAND_LEN];
+    const char * tmp = getenv("TMPDIR");
+
+    snprintf(benchDir, sizeof(benchDir), "%s/mathbench-XXXXXX", ( tmp != NULL && tmp[0] != '\0' ) ? tmp : "/tmp");
+
+    if( mkdtemp(benchDir) == NULL || setenv("TMPDIR", benchDir, 1) != 0 ) {
+        fprintf(stderr, "mathbench: could not make a directory for the data\n");
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/x.vec", benchDir);
+
+    FILE * file = fopen(path, "wb");
+    bool written = ( file != NULL && fwrite(in, sizeof(double), n, file) == n );
+
+    if( file != NULL && fclose(file) != 0 ) {
+        written = false;
+    }
+
+    mmWorkspace * ws = mmWorkspaceCreate();
+    snprintf(command, sizeof(command), "map x %s", path);
+
+    if( ! written || mmExecute(ws, command) != 0 ) {
+        fprintf(stderr, "mathbench: could not write and map %s\n", path);
+        return 1;
+    }
+
+    printf("\n%zu elements in a mapped file\n", n);
+    printf("%6s %10s %10s %8s\n", "", "off s", "on s", "speedup");
+
+    for(size_t c = 0; c < numCases; ++c) {
+        snprintf(command, sizeof(command), "%s x", cases[c].name);
+
+        mmExecute(ws, "fastmath off");
+        double offSeconds = timeCommand(ws, command);
+        mmExecute(ws, "fastmath on");
+        double onSeconds = timeCommand(ws, command);
+
+        printf("%6s %10.3f %10.3f %7.2fx\n", cases[c].name, offSeconds, onSeconds, offSeconds / onSeconds);
+    }
+
+    mmExecute(ws, "clear");
+    mmWorkspaceDestroy(ws);
+    unlink(path);
+    rmdir(benchDir);
+    free(in);
+    free(out);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file sortbench.c
+ * @brief Times minimat's cumsum and sort of a file-backed vector against
+ * a serial scan and qsort of the same doubles in memory
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Usage: sortbench [max elements]
+ *
+ * Algorithm:
+ *  - For 10^6, 10^7, ... elements up to the maximum (10^9 by default)
+ *    write uniform random doubles to a file and map it as x
+ *  - Time "cumsum x" and "sort x" through mmExecute, the way a program
+ *    embedding libminimat runs them, with the file in the page cache
+ *  - Time qsort and a serial running sum over the same doubles read
+ *    into memory, and check minimat's results against them
+ *    - minimat's results are found through TMPDIR, which is pointed at
+ *      the benchmark's own directory before minimat starts
+ */
+
+#include "libminimat.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MAX_ELEMENTS 1000000000.0
+#define FIRST_ELEMENTS 1000000.0
+#define BENCH_PATH_LEN 256
+#define BENCH_COMMAND_LEN ( BENCH_PATH_LEN + 32 )
+
+static char benchDir[BENCH_PATH_LEN];
+static char resultDir[2 * BENCH_PATH_LEN];
+
+
+static double secondsSince(const struct timespec * start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+
+static int compareDoubles(const void * a, const void * b) {
+
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+
+static uint64_t splitmix(uint64_t * state) {
+
+    uint64_t z = ( *state += 0x9E3779B97F4A7C15ULL );
+
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return z ^ ( z >> 31 );
+}
+
+
+/**
+ * Writes n random doubles to path and reads them back into memory
+ */
+static double * writeData(const char * path, size_t n) {
+
+    double * data = malloc(n * sizeof(double));
+    FILE * out = fopen(path, "wb");
+    uint64_t state = n;
+
+    if( data == NULL || out == NULL ) {
+        free(data);
+        if( out != NULL ) fclose(out);
+        return NULL;
+    }
+
+    for(size_t i = 0; i < n; ++i) {
+        data[i] = ( splitmix(&state) >> 11 ) * ( 1.0 / 9007199254740992.0 ) * 2e6 - 1e6;
+    }
+
+    bool written = fwrite(data, sizeof(double), n, out) == n;
+
+    if( fclose(out) != 0 || ! written ) {
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+
+/**
+ * Maps minimat's current ans, which lives in the directory it made
+ * under the benchmark's own
+ */
+static const double * mapAnswer(size_t n) {
+
+    if( resultDir[0] == '\0' ) {
+        DIR * dir = opendir(benchDir);
+        struct dirent * entry;
+
+        while( dir != NULL && ( entry = readdir(dir) ) != NULL ) {
+            if( strncmp(entry->d_name, "minimat-", 8) == 0 ) {
+                snprintf(resultDir, sizeof(resultDir), "%s/%s", benchDir, entry->d_name);
+            }
+        }
+
+        if( dir != NULL ) closedir(dir);
+    }
+
+    char path[sizeof(resultDir) + 16];
+    snprintf(path, sizeof(path), "%s/ans.vec", resultDir);
+
+    int fd = open(path, O_RDONLY);
+
+    if( fd < 0 ) {
+        return NULL;
+    }
+
+    void * answer = mmap(NULL, n * sizeof(double), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return ( answer == MAP_FAILED ) ? NULL : answer;
+}
+
+
+static bool runSize(mmWorkspace * ws, size_t n) {
+
+    char path[BENCH_PATH_LEN + 16];
+    char command[BENCH_COMMAND_LEN];
+    struct timespec start;
+
+    snprintf(path, sizeof(path), "%s/x.vec", benchDir);
+
+    double * data = writeData(path, n);
+    double * scan = malloc(n * sizeof(double));
+
+    if( data == NULL || scan == NULL ) {
+        fprintf(stderr, "sortbench: not enough memory or disk for %zu elements\n", n);
+        free(data);
+        free(scan);
+        return false;
+    }
+
+    snprintf(command, sizeof(command), "map x %s", path);
+
+    if( mmExecute(ws, command) != 0 ) {
+        fprintf(stderr, "sortbench: could not map %s\n", path);
+        unlink(path);
+        free(data);
+        free(scan);
+        return false;
+    }
+
+    // Warm the page cache so both sides start from memory
+    mmExecute(ws, "cumsum x");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int failed = mmExecute(ws, "cumsum x");
+    double scanSeconds = secondsSince(&start);
+
+    const double * sums = mapAnswer(n);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double running = 0.0;
+    for(size_t i = 0; i < n; ++i) {
+        scan[i] = running += data[i];
+    }
+    double serialSeconds = secondsSince(&start);
+
+    // Threads total their parts separately, so sums may differ in rounding
+    double worst = ( failed || sums == NULL ) ? INFINITY : 0.0;
+
+    for(size_t i = 0; sums != NULL && i < n; ++i) {
+        double error = fabs(sums[i] - scan[i]) / ( fabs(scan[i]) > 1.0 ? fabs(scan[i]) : 1.0 );
+        worst = ( error > worst ) ? error : worst;
+    }
+
+    if( sums != NULL ) munmap((void *) sums, n * sizeof(double));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed = mmExecute(ws, "sort x");
+    double radixSeconds = secondsSince(&start);
+
+    const double * sorted = mapAnswer(n);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(data, n, sizeof(double), compareDoubles);
+    double qsortSeconds = secondsSince(&start);
+
+    bool sortMatches = ! failed && sorted != NULL && memcmp(sorted, data, n * sizeof(double)) == 0;
+
+    if( sorted != NULL ) munmap((void *) sorted, n * sizeof(double));
+
+    printf("%12zu %10.3f %10.3f %7.2fx %9.1e %10.3f %10.3f %7.2fx %s\n", n,
+           scanSeconds, serialSeconds, serialSeconds / scanSeconds, worst,
+           radixSeconds, qsortSeconds, qsortSeconds / radixSeconds, sortMatches ? "same" : "DIFF");
+    fflush(stdout);
+
+    mmExecute(ws, "clear");
+    resultDir[0] = '\0';
+    unlink(path);
+    free(data);
+    free(scan);
+
+    return sortMatches && worst < 1e-9;
+}
+
+
+int main(int argc, char * argv[]) {
+
+    double maxElements = ( argc > 1 ) ? atof(argv[1]) : DEFAULT_MAX_ELEMENTS;
+    const char * tmp = getenv("TMPDIR");
+
+    snprintf(benchDir, sizeof(benchDir), "%s/sortbench-XXXXXX", ( tmp != NULL && tmp[0] != '\0' ) ? tmp : "/tmp");
+
+    if( mkdtemp(benchDir) == NULL || setenv("TMPDIR", benchDir, 1) != 0 ) {
+        fprintf(stderr, "sortbench: could not make a directory for the data\n");
+        return 1;
+    }
+
+    mmWorkspace * ws = mmWorkspaceCreate();
+    bool allMatch = true;
+
+    printf("%12s %10s %10s %8s %9s %10s %10s %8s %4s\n", "elements", "cumsum s", "serial s", "speedup",
+           "rel err", "sort s", "qsort s", "speedup", "");
+
+    for(double n = FIRST_ELEMENTS; n <= maxElements; n *= 10) {
+        if( ! runSize(ws, (size_t) n) ) {
+            allMatch = false;
+        }
+    }
+
+    mmWorkspaceDestroy(ws);
+    rmdir(benchDir);
+
+    return allMatch ? 0 : 1;
+}
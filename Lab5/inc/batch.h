@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "minimatcmd.h"
+#include <stdio.h>
+
+// Statements scheduled together, a window ends early at commands that
+// have to run alone (clear, map, jit, profile, the random generators)
+#define BATCH_WINDOW 64
+#define MAX_BATCH_THREADS 64
+
+// The vector names a command reads and stores, point into the command
+typedef struct {
+
+    const char * reads[MAX_NUM_OPERANDS + 1]; // operands and a mask or source
+    int numReads;
+    const char * write; // NULL if nothing is stored
+    bool evaluate; // result computed off the main thread, stored by it
+
+} commandAccess;
+
+void classifyCommand( const minimatcmd * cmd, commandAccess * access );
+
+bool accessesConflict( const commandAccess * earlier, const commandAccess * later );
+
+bool runsAlone( minimatcmd cmd );
+
+void runBatch( FILE * input, int numThreads );
+
+#endif /* batch.h */
@@ -0,0 +1,38 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Compressed copies are written to <name> + suffix beside the mapped results
+#define COMPRESSED_SUFFIX ".vgz"
+#define COMPRESSED_MAGIC 0x5A474D4DU // "MMGZ"
+
+// Reads a Gorilla stream back one value at a time, in order
+typedef struct {
+
+    FILE * in;
+    uint64_t word; // bits not yet consumed, most significant first
+    int bitsLeft;
+    uint64_t previous; // last value's bits
+    int leading; // leading zeros of the current XOR window
+    int meaningful; // width of the current XOR window
+    size_t remaining; // values left in the stream
+    bool started;
+
+} gorillaDecoder;
+
+bool compressFile( const char * rawPath, size_t length, const char * packedPath, size_t * packedBytes );
+
+// True if the compressed copy decodes to exactly the raw file's values
+bool verifyCompressed( const char * rawPath, size_t length, const char * packedPath );
+
+bool openDecoder( gorillaDecoder * decoder, const char * packedPath );
+
+void decodeValues( gorillaDecoder * decoder, double * out, size_t count );
+
+void closeDecoder( gorillaDecoder * decoder );
+
+#endif /* compress.h */
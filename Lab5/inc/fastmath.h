@@ -0,0 +1,39 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stddef.h>
+
+// Elements converted per pass, the fixed up block is copied out after
+#define FASTMATH_BLOCK 256
+
+// Worst error against libm in units in the last place, over the inputs
+// each function computes itself. Anything else is handed to libm
+#define FAST_SQRT_ULP 0
+#define FAST_ABS_ULP 0
+#define FAST_EXP_ULP 2
+#define FAST_LOG_ULP 2
+#define FAST_SIN_ULP 2
+#define FAST_COS_ULP 2
+#define FAST_TANH_ULP 4
+
+// Largest |x| sin and cos reduce themselves
+#define FAST_TRIG_MAX 65536.0
+
+// Applies a function to count elements, in and out may be the same array
+typedef void (*arrayFn)( const double * in, double * out, size_t count );
+
+void fastSqrt( const double * in, double * out, size_t count );
+
+void fastAbs( const double * in, double * out, size_t count );
+
+void fastExp( const double * in, double * out, size_t count );
+
+void fastLog( const double * in, double * out, size_t count );
+
+void fastSin( const double * in, double * out, size_t count );
+
+void fastCos( const double * in, double * out, size_t count );
+
+void fastTanh( const double * in, double * out, size_t count );
+
+#endif /* fastmath.h */
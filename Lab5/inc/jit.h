@@ -0,0 +1,27 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+
+// Element-wise operations that can be compiled to native code
+typedef enum {
+
+    JIT_ADD,
+    JIT_SUB,
+    JIT_SCALE, // out = a * (*b)
+    JIT_NUM_OPS
+
+} jitOperation;
+
+// Compiled loop over a fixed number of elements
+typedef void (*jitKernel)(const double * a, const double * b, double * out);
+
+bool jitSupported( void );
+
+bool jitEnabled( void );
+
+void setJitEnabled( bool enabled );
+
+jitKernel jitLookup( jitOperation op, int vecSize );
+
+#endif /* jit.h */
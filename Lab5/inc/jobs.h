@@ -0,0 +1,22 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "minimatcmd.h"
+#include <stdbool.h>
+
+// Jobs in flight at once, one more waits for the oldest first
+#define MAX_JOBS 16
+// A job's result that would be "ans" is stored as this plus the job id
+#define JOB_RESULT_PREFIX "job"
+
+bool canRunInBackground( minimatcmd cmd );
+
+bool submitJob( minimatcmd cmd );
+
+void settleJobs( minimatcmd cmd );
+
+bool waitJob( int id );
+
+void listJobs( void );
+
+#endif /* jobs.h */
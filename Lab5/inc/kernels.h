@@ -0,0 +1,26 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "vector.h"
+#include <stddef.h>
+
+// Largest size with its own kernel, longer runs are done in pieces
+#define KERNEL_MAX_SIZE 16
+
+// Same shape as a jitKernel so either can be called through one pointer
+typedef void (*vectorKernel)(const double * a, const double * b, double * out);
+typedef double (*reductionKernel)(const double * a, const double * b);
+
+// Indexed by vector size, 0 through KERNEL_MAX_SIZE
+extern const vectorKernel addKernels[KERNEL_MAX_SIZE + 1];
+extern const vectorKernel subKernels[KERNEL_MAX_SIZE + 1];
+extern const vectorKernel scaleKernels[KERNEL_MAX_SIZE + 1]; // out = a * (*b)
+extern const vectorKernel axpyKernels[KERNEL_MAX_SIZE + 1]; // out += (*b) * a
+extern const reductionKernel dotKernels[KERNEL_MAX_SIZE + 1];
+
+// One of the tables above over count elements of any length
+void runKernels( const vectorKernel * table, const double * a, const double * b, double * out, size_t count );
+
+double runReduction( const reductionKernel * table, const double * a, const double * b, size_t count );
+
+#endif /* kernels.h */
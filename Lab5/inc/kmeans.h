@@ -0,0 +1,16 @@
+#ifndef KMEANS_H
+#define KMEANS_H
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define KMEANS_MAX_ITERATIONS 300
+// Vectors needed before each pass is split across threads
+#define KMEANS_PARALLEL_MIN 4096
+#define MAX_KMEANS_THREADS 16
+// Centroids are stored as CENTROID_PREFIX1, CENTROID_PREFIX2, ...
+#define CENTROID_PREFIX "centroid"
+
+bool kmeans( const char * clusters, const char * args );
+
+#endif /* kmeans.h */
@@ -0,0 +1,76 @@
+#ifndef LIBMINIMAT_H
+#define LIBMINIMAT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Bumped on any incompatible change to the declarations below
+#define LIBMINIMAT_VERSION_MAJOR 1
+#define LIBMINIMAT_VERSION_MINOR 2
+#define LIBMINIMAT_VERSION_PATCH 0
+#define LIBMINIMAT_VERSION ( LIBMINIMAT_VERSION_MAJOR * 10000 + \
+                             LIBMINIMAT_VERSION_MINOR * 100 + \
+                             LIBMINIMAT_VERSION_PATCH )
+
+// Most elements a vector holds, the size of buffers for mmVectorGet
+#define MM_MAX_VECTOR_SIZE 3
+
+// Only the functions marked MM_API are exported from the shared library,
+// the rest of minimat is built with hidden visibility
+#define MM_API __attribute__((visibility("default")))
+
+// Opaque set of named vectors, independent of the REPL's own workspace.
+// Different threads may use different workspaces at the same time, but
+// one workspace must only be used by one thread at a time
+typedef struct workspace mmWorkspace;
+
+// Values are part of the ABI, only ever append
+typedef enum {
+
+    MM_ADD = 0,
+    MM_SUB = 1,
+    MM_DOTPROD = 2,
+    MM_XPROD = 3,
+    MM_SCALARMUL = 4,
+    MM_SORT = 5,
+    MM_ARGSORT = 6, // one-based positions
+    MM_CUMSUM = 7,
+    MM_CUMPROD = 8,
+    MM_SQRT = 9,
+    MM_EXP = 10,
+    MM_LOG = 11,
+    MM_SIN = 12,
+    MM_COS = 13,
+    MM_TANH = 14,
+    MM_ABS = 15
+
+} mmOperation;
+
+MM_API int mmVersion( void );
+
+MM_API mmWorkspace * mmWorkspaceCreate( void );
+
+MM_API void mmWorkspaceDestroy( mmWorkspace * ws );
+
+// Workspaces start silent, pass a stream to get REPL style printing
+MM_API void mmWorkspaceSetOutput( mmWorkspace * ws, FILE * out );
+
+// Up to MM_MAX_VECTOR_SIZE elements are copied. A longer data is borrowed
+// without a copy and read in place by every operation on name, so it must
+// stay valid until name is replaced or the vectors are cleared. Borrowed
+// vectors are shared by all workspaces, and minimat never writes to them
+MM_API bool mmVectorSet( mmWorkspace * ws, const char * name, const double * data, int size );
+
+// data must have room for MM_MAX_VECTOR_SIZE doubles, *size gets how
+// many were written. It fails for the longer, borrowed or file-backed ones
+MM_API bool mmVectorGet( mmWorkspace * ws, const char * name, double * data, int * size );
+
+// Runs op on the named operands (b is ignored by unary ops and scalarmul)
+// and stores the result as dst
+MM_API bool mmApply( mmWorkspace * ws, mmOperation op, const char * dst,
+                     const char * a, const char * b, double scalar );
+
+// Runs newline or ';' separated minimat commands, returns how many failed
+MM_API int mmExecute( mmWorkspace * ws, const char * commands );
+
+#endif /* libminimat.h */
@@ -0,0 +1,60 @@
+#ifndef MAPPED_H
+#define MAPPED_H
+
+#include "minimatcmd.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_MAPPED_VECTORS 10
+// Window mapped per operand at a time, bounds the resident set
+#ifndef MAPPED_CHUNK_BYTES
+#define MAPPED_CHUNK_BYTES ( 64 << 20 )
+#endif
+// File-backed results are written to <name> + suffix in a private temporary directory
+#define MAPPED_RESULT_SUFFIX ".vec"
+// Commands a file-backed vector goes unused before "compress on" packs it
+#define COLD_AFTER_COMMANDS 8
+
+bool mapVectorFile( const char * name, const char * path );
+
+// Names length doubles at data without copying them. They are read, never
+// written, until the name is replaced or cleared
+bool borrowVector( const char * name, const double * data, size_t length );
+
+bool defineGenerator( const char * name, const char * kind, const double * args, int numArgs );
+
+bool materializeVector( const char * name );
+
+bool isMappedVector( const char * name );
+
+bool anyMappedVectors( void );
+
+void unmapVector( const char * name );
+
+void unmapVectors( void );
+
+bool involvesMappedVectors( minimatcmd cmd );
+
+bool executeMappedCmd( minimatcmd cmd );
+
+// executeMappedCmd in three steps, so the streaming in the middle can run
+// off the main thread. Prepare and finish run on the main thread, and the
+// result that would be "ans" is stored under resultName instead
+typedef struct mappedTask mappedTask;
+
+mappedTask * prepareMappedCmd( minimatcmd cmd, const char * resultName );
+
+void runMappedTask( mappedTask * task );
+
+bool finishMappedTask( mappedTask * task );
+
+void setCompressCold( bool enabled );
+
+void compressColdVectors( void );
+
+// Element-wise functions of mapped vectors trade exactness for speed
+void setFastMath( bool enabled );
+
+void printMappedVectors( void );
+
+#endif /* mapped.h */
@@ -0,0 +1,35 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define MAX_MATRICES 10
+// Pivots smaller than this are treated as zero
+#define SINGULAR_TOLERANCE 1e-12
+
+typedef struct {
+
+    char matName[MAX_VECTOR_NAME_LEN]; // name of matrix
+    double entries[MAX_VECTOR_DIMENSION][MAX_VECTOR_DIMENSION]; // [row][col]
+    int matSize; // rows and columns, matrices are square
+
+    // Factorizations are computed on first use and kept until the matrix
+    // is reassigned, which rebuilds the whole struct
+    bool luValid;
+    double lu[MAX_VECTOR_DIMENSION][MAX_VECTOR_DIMENSION]; // L below, U on and above diagonal
+    int pivots[MAX_VECTOR_DIMENSION]; // row of the original in each LU row
+    bool cholValid;
+    double chol[MAX_VECTOR_DIMENSION][MAX_VECTOR_DIMENSION]; // lower triangular
+
+} matrix;
+
+bool createMatrix( const char * name, const char * rowNames );
+
+vector solve( const char * name, vector b );
+
+bool chol( const char * name );
+
+void clearMatrices( void );
+
+#endif /* matrix.h */
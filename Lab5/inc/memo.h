@@ -0,0 +1,31 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "minimatcmd.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEFAULT_MEMO_BUDGET ( 64 * 1024 )
+
+// What a result depends on: the operation, which vectors and which
+// contents of them, and the scalar
+typedef struct {
+
+    minimatcmdType operation;
+    uint32_t operandSlots[MAX_NUM_OPERANDS];
+    uint64_t operandVersions[MAX_NUM_OPERANDS];
+    double scalar;
+
+} memoKey;
+
+bool memoKeyFor( const minimatcmd * cmd, memoKey * key );
+
+bool memoLookup( const memoKey * key, vector * ans );
+
+void memoStore( const memoKey * key, const vector * ans );
+
+void setMemoBudget( size_t bytes );
+
+void printMemoStats( void );
+
+#endif /* memo.h */
@@ -3,35 +3,144 @@
 
 #include "vector.h"
 
+#include <stdbool.h>
+
 #define MAX_NUM_OPERANDS 2
+#define INPUT_BUFFER_SIZE 100
 #define DATA_CREATE_SYMBOL '='
 #define ADD_SYMBOL '+'
 #define SUB_SYMBOL '-'
 #define DOTPROD_SYMBOL '*'
 #define XPROD_SYMBOL 'x'
 #define SCALARMUL_SYMBOL '*'
+#define GREATER_SYMBOL '>'
+#define LESS_SYMBOL '<'
+#define INDEX_OPEN_SYMBOL '['
+#define INDEX_CLOSE_SYMBOL ']'
+#define ADD_ASSIGN_SYMBOL "+="
+#define SUB_ASSIGN_SYMBOL "-="
+#define SCALE_ASSIGN_SYMBOL "*="
+#define BACKGROUND_SYMBOL '&'
 #define EXIT_SYMBOL "exit"
+#define SORT_KEYWORD "sort"
+#define ARGSORT_KEYWORD "argsort"
+#define CUMSUM_KEYWORD "cumsum"
+#define CUMPROD_KEYWORD "cumprod"
+#define SQRT_KEYWORD "sqrt"
+#define EXP_KEYWORD "exp"
+#define LOG_KEYWORD "log"
+#define SIN_KEYWORD "sin"
+#define COS_KEYWORD "cos"
+#define TANH_KEYWORD "tanh"
+#define ABS_KEYWORD "abs"
+#define RAND_KEYWORD "rand"
+#define RANDN_KEYWORD "randn"
+#define RANDI_KEYWORD "randi"
+#define SEED_KEYWORD "seed"
+#define MAP_KEYWORD "map"
+#define RANGE_KEYWORD "range"
+#define LINSPACE_KEYWORD "linspace"
+#define ZEROS_KEYWORD "zeros"
+#define ONES_KEYWORD "ones"
+#define MATERIALIZE_KEYWORD "materialize"
+#define MATRIX_KEYWORD "matrix"
+#define SOLVE_KEYWORD "solve"
+#define CHOL_KEYWORD "chol"
+#define PAIRWISE_KEYWORD "pairwise"
+#define KMEANS_KEYWORD "kmeans"
+#define CACHE_KEYWORD "cache"
+#define JIT_KEYWORD "jit"
+#define PROFILE_KEYWORD "profile"
+#define COMPRESS_KEYWORD "compress"
+#define FASTMATH_KEYWORD "fastmath"
+#define WHOS_KEYWORD "whos"
+#define STREAM_KEYWORD "stream"
+#define STATS_KEYWORD "stats"
+#define JOBS_KEYWORD "jobs"
+#define WAIT_KEYWORD "wait"
+#define WHERE_KEYWORD "where"
+#define SELECT_KEYWORD "select"
+#define ON_KEYWORD "on"
+#define OFF_KEYWORD "off"
 
 
 typedef enum {
 
     DATA_CREATE,
+    DATA_COPY,
     ADD,
     SUB,
     DOTPROD,
     XPROD,
     SCALARMUL,
     CLEAR,
+    SORT,
+    ARGSORT,
+    CUMSUM,
+    CUMPROD,
+    SQRT,
+    EXP,
+    LOG,
+    SIN,
+    COS,
+    TANH,
+    ABS,
+    RAND,
+    RANDN,
+    RANDI,
+    SEED,
+    SET_JIT,
+    SET_PROFILE,
+    MAP_FILE,
+    MATRIX_CREATE,
+    SOLVE,
+    CHOL,
+    CACHE_STATS,
+    SET_CACHE_BUDGET,
+    PAIRWISE,
+    KMEANS,
+    GENERATOR_CREATE,
+    MATERIALIZE,
+    SET_COMPRESS,
+    WHOS,
+    STREAM_OPEN,
+    STREAM_STATS,
+    GREATER,
+    LESS,
+    WHERE,
+    SELECT,
+    COMPRESS_MASKED,
+    GATHER,
+    SCATTER,
+    ADD_ASSIGN,
+    SUB_ASSIGN,
+    SCALE_ASSIGN,
+    AXPY,
+    LIST_JOBS,
+    WAIT_JOB,
+    SET_FASTMATH,
     CMD_ERROR
 
 } minimatcmdType;
 
 typedef struct {
     minimatcmdType operation;
-    vector operands[MAX_NUM_OPERANDS];
-    double scalar;
+    vector operands[MAX_NUM_OPERANDS]; // numeric arguments go in the first
+    double scalar; // scalar operand, or 1/0 for on/off settings
+    char arguments[INPUT_BUFFER_SIZE]; // file path or name list of longer commands
+    bool background; // ended in "&", runs as a job
 
 } minimatcmd;
 
+minimatcmd minimatProcessCmd( char * cmdInput );
+
+bool minimatEvaluateCmd( minimatcmd cmd, vector * ans );
+
+bool minimatCommitResult( vector ans );
+
+bool minimatExecuteCmd( minimatcmd cmd );
+
+bool minimatExecutionLoop( void );
+
 
 #endif /* end of minimatcmd.h */
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define PACKED_FILE_SYMBOL ">"
+
+// Stored vectors copied out into one array per coordinate
+typedef struct {
+
+    int count; // number of vectors
+    int dims; // shared dimension
+    double * coords[MAX_VECTOR_DIMENSION]; // coords[d][i]
+    char (* names)[MAX_VECTOR_NAME_LEN]; // name of vector i
+
+} packedVectors;
+
+bool packVectors( packedVectors * packed, char * names, const char ** path );
+
+void freePackedVectors( packedVectors * packed );
+
+#endif /* packed.h */
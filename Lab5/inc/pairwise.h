@@ -0,0 +1,20 @@
+#ifndef PAIRWISE_H
+#define PAIRWISE_H
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define PAIRWISE_L2_KEYWORD "l2"
+#define PAIRWISE_COSINE_KEYWORD "cosine"
+#define PAIRWISE_GRAM_KEYWORD "gram"
+// Rows and columns of vectors computed together
+#define PAIRWISE_BLOCK 64
+// Vectors needed before the work is split across threads
+#define PAIRWISE_PARALLEL_MIN 512
+#define MAX_PAIRWISE_THREADS 16
+// Larger results have to be written to a file
+#define PAIRWISE_PRINT_MAX 16
+
+bool pairwise( const char * metric, const char * args );
+
+#endif /* pairwise.h */
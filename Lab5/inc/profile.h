@@ -0,0 +1,31 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+
+// Hardware events counted around every command while profiling
+typedef enum {
+
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_PROFILE_COUNTERS
+
+} profileCounter;
+
+bool startProfiling( void );
+
+void stopProfiling( void );
+
+bool profilingEnabled( void );
+
+void profileBegin( void );
+
+void profileEnd( int operation );
+
+void printProfile( void );
+
+const char * commandName( int operation );
+
+#endif /* profile.h */
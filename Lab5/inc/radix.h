@@ -0,0 +1,48 @@
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bits of the key sorted by each pass, RADIX_PASSES passes cover all 64
+#define RADIX_BITS 11
+#define RADIX_BUCKETS ( 1 << RADIX_BITS )
+#define RADIX_PASSES ( ( 64 + RADIX_BITS - 1 ) / RADIX_BITS )
+// Elements a thread holds per bucket before writing them out
+#define RADIX_BUFFER 128
+// Elements needed before a window is split across threads
+#define RADIX_PARALLEL_MIN 65536
+#define MAX_RADIX_THREADS 16
+
+// One window of elements going through a pass. The first pass reads the
+// source doubles, later ones the records the pass before wrote: the key,
+// followed by the element's position when the sort is indexed
+typedef struct {
+
+    const double * values; // source window, NULL when reading records
+    const uint64_t * records;
+    size_t first; // position of the window's first element
+    size_t count;
+
+} radixWindow;
+
+typedef struct {
+
+    int digit; // which RADIX_BITS of the key this pass sorts on
+    bool indexed; // argsort, the records carry positions
+    bool last; // write the result (values, or one-based positions) not records
+    int fdOut;
+    uint64_t next[RADIX_BUCKETS]; // where each bucket's next element goes
+
+} radixPass;
+
+uint64_t orderedKey( double d );
+
+double keyValue( uint64_t key );
+
+bool radixCount( const radixWindow * window, uint64_t counts[RADIX_PASSES][RADIX_BUCKETS] );
+
+bool radixScatter( const radixWindow * window, radixPass * pass );
+
+#endif /* radix.h */
@@ -0,0 +1,47 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "vector.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEFAULT_RANDOM_SEED 0x5EED
+// Elements needed before a fill is split across threads
+#define RANDOM_PARALLEL_MIN 65536
+#define MAX_RANDOM_THREADS 16
+
+typedef enum {
+
+    RANDOM_UNIFORM,
+    RANDOM_NORMAL,
+    RANDOM_INTEGER
+
+} randomKind;
+
+// The part of the sequence one command takes. Element i depends only on
+// the run and i, so a run can be filled a block at a time in any order
+typedef struct {
+
+    randomKind kind;
+    uint64_t seed; // as it was when the run was taken
+    uint64_t first; // sequence index of element 0
+    double lo;
+    uint64_t range; // integers are drawn from [lo, lo + range)
+
+} randomRun;
+
+void seedRandom( uint64_t seed );
+
+double nextUniform( void );
+
+bool startRandomRun( randomRun * run, randomKind kind, double lo, double hi, size_t n );
+
+void fillRandomRun( const randomRun * run, size_t first, double * out, size_t count );
+
+vector randu( double n );
+
+vector randn( double n );
+
+vector randi( double lo, double hi, double n );
+
+#endif /* random.h */
@@ -0,0 +1,13 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Elements needed before a window is split across threads
+#define SCAN_PARALLEL_MIN 65536
+#define MAX_SCAN_THREADS 16
+
+void scanWindow( double * values, size_t count, double * carry, bool product );
+
+#endif /* scan.h */
@@ -0,0 +1,24 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "minimatcmd.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+#define REPEAT_KEYWORD "repeat"
+#define FOR_KEYWORD "for"
+#define END_KEYWORD "end"
+#define RANGE_SEPARATOR ':'
+#define MAX_BLOCK_DEPTH 16
+
+typedef struct scriptBlock scriptBlock;
+
+bool isBlockStart( const char * line );
+
+scriptBlock * compileBlock( char * header, FILE * input );
+
+void runBlock( const scriptBlock * block );
+
+void freeBlock( scriptBlock * block );
+
+#endif /* script.h */
@@ -0,0 +1,23 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define MAX_STREAMS 10
+// Largest window a stream keeps
+#define MAX_STREAM_WINDOW ( 1 << 24 )
+// Bytes read from the source at a time
+#define STREAM_READ_BYTES ( 64 * 1024 )
+// How often a blocked reader checks whether it should stop
+#define STREAM_POLL_MS 100
+
+bool openStream( const char * name, const char * args );
+
+bool printStreamStats( const char * name );
+
+bool isStream( const char * name );
+
+void closeStreams( void );
+
+#endif /* stream.h */
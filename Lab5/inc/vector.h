@@ -2,14 +2,19 @@
 #define VECTOR_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 // Only want to represent vectors in three dimensions at most
 #define MAX_VECTOR_DIMENSION 3
 // Length of a name of a vector at maximum is 50
 #define MAX_VECTOR_NAME_LEN 50
-#define MAX_VECTORS 10
+// Workspace storage grows one slab of this many vectors at a time
+#define VECTORS_PER_SLAB 64
 
 #define SAME_DIMENSIONS(a, b) ( a.vecSize == b.vecSize )
+// Operations that fail report why and return an empty vector
+#define FAILED_RESULT(v) ( (v).vecSize == 0 )
 
 typedef struct {
 
@@ -19,6 +24,44 @@ typedef struct {
 
 } vector;
 
+typedef struct {
+
+    vector vectors[VECTORS_PER_SLAB]; // contiguous vector data
+    uint32_t generations[VECTORS_PER_SLAB]; // workspace generation at store
+    uint64_t versions[VECTORS_PER_SLAB]; // unique stamp of the stored contents
+
+} vectorSlab;
+
+// Refers to a stored vector until the workspace is cleared or a vector
+// is removed
+typedef struct {
+
+    uint32_t index; // slot across all slabs
+    uint32_t generation;
+
+} vectorHandle;
+
+typedef struct workspace {
+
+    vectorSlab ** slabs; // kept across clears and reused
+    int numSlabs;
+    int numVectors; // live vectors, packed from slot 0
+    uint32_t generation; // bumped by clear, stales every handle
+    FILE * output; // where results and errors are printed, NULL for stdout
+    bool quiet; // suppress all printing
+
+} workspace;
+
+workspace * createWorkspace( void );
+
+void destroyWorkspace( workspace * ws );
+
+void setThreadOutput( FILE * out );
+
+workspace * setThreadWorkspace( workspace * ws );
+
+workspace * snapshotVectors( const char * const * names, int count );
+
 vector add(vector a, vector b);
 
 vector sub(vector a, vector b);
@@ -29,12 +72,55 @@ vector scalarmul(vector a, double b);
 
 vector xprod(vector a, vector b);
 
-void addVectorToMemoryList( vector toAdd );
+vector sort(vector a);
+
+// One-based positions of a's elements in ascending order
+vector argsort(vector a);
+
+vector cumsum(vector a);
+
+vector cumprod(vector a);
+
+vector elementwise(vector a, double (*fn)(double));
+
+vector compare(vector a, vector b, char relation);
+
+vector where(vector mask, vector a, vector b);
+
+vector selectWhere(vector mask, vector a);
+
+vector compressWhere(vector mask, vector a);
+
+vector gather(vector a, vector idx);
+
+vector scatter(vector a, vector idx, vector b);
+
+vector axpyInPlace( const char * name, double scalar, vector x );
+
+vector scaleInPlace( const char * name, double scalar );
+
+bool addVectorToMemoryList( vector toAdd );
+
+void removeVector( const char * name );
 
 void clearVectors( void );
 
+bool findVector( const char * name, vectorHandle * handle );
+
+vector * vectorFromHandle( vectorHandle handle );
+
+uint64_t vectorVersion( vectorHandle handle );
+
+int numStoredVectors( void );
+
+vector * storedVectorAt( int index );
+
 void printVector( vector toPrint );
 
+void printStoredVectors( void );
+
+void printMessage( const char * msg );
+
 bool grabVector(vector *a);
 
 void copyVectorKeepName( vector *src, vector *dst );
@@ -0,0 +1,506 @@
+/**
+ * @file batch.c
+ * @brief Runs minimat scripts with independent statements in parallel
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Parse a window of statements and note the vector names each reads
+ *    and writes
+ *  - Give each statement a level one past the deepest earlier statement
+ *    whose result it reads, and no lower than any earlier statement it
+ *    otherwise conflicts with (write after read or write)
+ *  - For each level in turn
+ *    - Worker threads evaluate the level's statements, which only read
+ *    - The main thread stores their results in program order
+ *  - Everything a statement prints is captured and the window's output is
+ *    written in program order, so it matches running one at a time
+ */
+
+#include "batch.h"
+#include "mapped.h"
+#include "minimatcmd.h"
+#include "profile.h"
+#include "script.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+
+    minimatcmd cmd;
+    commandAccess access;
+    int level;
+    vector ans;
+    FILE * stream; // captures what the statement prints
+    char * output;
+    size_t outputLen;
+
+} batchStatement;
+
+static pthread_t workers[MAX_BATCH_THREADS];
+static int numWorkers = 0;
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workDone = PTHREAD_COND_INITIALIZER;
+static batchStatement ** pending; // statements of the level being run
+static int pendingCount = 0;
+static int nextPending = 0;
+static int unfinished = 0;
+static unsigned generation = 0;
+static bool shuttingDown = false;
+
+
+// Unnamed operands are literals and read nothing
+static void addRead(commandAccess * access, const char * name) {
+
+    if( name[0] != '\0' ) {
+        access->reads[access->numReads++] = name;
+    }
+}
+
+
+/**
+ * Fills in the read and write sets of a parsed command
+ */
+void classifyCommand( const minimatcmd * cmd, commandAccess * access ) {
+
+    access->numReads = 0;
+    access->write = NULL;
+    access->evaluate = false;
+
+    switch(cmd->operation) {
+
+        case DATA_CREATE:
+            access->write = cmd->operands[0].vecName;
+            break;
+
+        case DATA_COPY:
+            access->reads[access->numReads++] = cmd->operands[1].vecName;
+            access->write = cmd->operands[0].vecName;
+            break;
+
+        case ADD:
+        case SUB:
+        case DOTPROD:
+        case XPROD:
+            access->reads[access->numReads++] = cmd->operands[0].vecName;
+            access->reads[access->numReads++] = cmd->operands[1].vecName;
+            access->write = "ans";
+            access->evaluate = true;
+            break;
+
+        case SCALARMUL:
+            access->reads[access->numReads++] = cmd->operands[0].vecName;
+            access->write = cmd->operands[0].vecName;
+            access->evaluate = true;
+            break;
+
+        case SORT:
+        case ARGSORT:
+        case CUMSUM:
+        case CUMPROD:
+        case SQRT:
+        case EXP:
+        case LOG:
+        case SIN:
+        case COS:
+        case TANH:
+        case ABS:
+            access->reads[access->numReads++] = cmd->operands[0].vecName;
+            access->write = "ans";
+            access->evaluate = true;
+            break;
+
+        case GREATER:
+        case LESS:
+        case GATHER:
+            addRead(access, cmd->operands[0].vecName);
+            addRead(access, cmd->operands[1].vecName);
+            access->write = "ans";
+            access->evaluate = true;
+            break;
+
+        case WHERE:
+        case SELECT:
+        case COMPRESS_MASKED:
+            addRead(access, cmd->arguments);
+            addRead(access, cmd->operands[0].vecName);
+            addRead(access, cmd->operands[1].vecName);
+            access->write = "ans";
+            access->evaluate = true;
+            break;
+
+        case SCATTER:
+            addRead(access, cmd->operands[0].vecName);
+            addRead(access, cmd->operands[1].vecName);
+            addRead(access, cmd->arguments);
+            access->write = cmd->operands[0].vecName;
+            access->evaluate = true;
+            break;
+
+        // Rewritten in place when committed, in program order
+        case ADD_ASSIGN:
+        case SUB_ASSIGN:
+        case AXPY:
+            addRead(access, cmd->operands[0].vecName);
+            addRead(access, cmd->operands[1].vecName);
+            access->write = cmd->operands[0].vecName;
+            break;
+
+        case SCALE_ASSIGN:
+            access->reads[access->numReads++] = cmd->operands[0].vecName;
+            access->write = cmd->operands[0].vecName;
+            break;
+
+        default:
+            // Errors only print, so they depend on nothing
+            break;
+    }
+}
+
+
+/**
+ * Commands that touch more than named vectors run alone, in order
+ */
+bool runsAlone( minimatcmd cmd ) {
+
+    switch(cmd.operation) {
+
+        case CLEAR:
+        case SET_JIT:
+        case SET_COMPRESS:
+        case SET_FASTMATH:
+        case WHOS:
+        // Streams change underneath, a query has to run in its place
+        case STREAM_OPEN:
+        case STREAM_STATS:
+        case SET_PROFILE:
+        case MAP_FILE:
+        case GENERATOR_CREATE:
+        case MATERIALIZE:
+        // Matrices and their cached factorizations live outside the names
+        case MATRIX_CREATE:
+        case SOLVE:
+        case CHOL:
+        // Hit counts depend on the order results were computed
+        case CACHE_STATS:
+        case SET_CACHE_BUDGET:
+        // Read every stored vector when no names are given, kmeans also
+        // draws from the generator and stores its centroids
+        case PAIRWISE:
+        case KMEANS:
+        // The generators advance one shared sequence, so order matters
+        case RAND:
+        case RANDN:
+        case RANDI:
+        case SEED:
+        // Jobs only exist outside of -j
+        case LIST_JOBS:
+        case WAIT_JOB:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * Statements the workers can't take are run by the main thread in order
+ */
+static bool isBarrier(minimatcmd cmd) {
+
+    // Counters only follow the main thread
+    return runsAlone(cmd) || anyMappedVectors() || profilingEnabled();
+}
+
+
+static bool readsName(const commandAccess * access, const char * name) {
+
+    for(int i = 0; i < access->numReads; ++i) {
+        if( strcmp(access->reads[i], name) == 0 ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool accessesConflict( const commandAccess * earlier, const commandAccess * later ) {
+
+    if( earlier->write != NULL ) {
+        if( readsName(later, earlier->write) ) {
+            return true;
+        }
+
+        if( later->write != NULL && strcmp(earlier->write, later->write) == 0 ) {
+            return true;
+        }
+    }
+
+    return later->write != NULL && readsName(earlier, later->write);
+}
+
+
+/**
+ * Lowest level later can go in given earlier. Only a read of what earlier
+ * stores needs the next level, a level is evaluated before any of it is
+ * stored and is stored in program order, so other conflicts can share it
+ */
+static int lowestLevel(const batchStatement * earlier, const batchStatement * later) {
+
+    if( earlier->access.write != NULL && readsName(&later->access, earlier->access.write) ) {
+        return earlier->level + 1;
+    }
+
+    return accessesConflict(&earlier->access, &later->access) ? earlier->level : 0;
+}
+
+
+static void evaluateStatement(batchStatement * stmt) {
+
+    setThreadOutput(stmt->stream);
+    minimatEvaluateCmd(stmt->cmd, &stmt->ans);
+    setThreadOutput(NULL);
+}
+
+
+/**
+ * Takes statements of the current level until none are left. Called with
+ * poolLock held, returns with it held.
+ */
+static void drainPending( void ) {
+
+    while( nextPending < pendingCount ) {
+        batchStatement * stmt = pending[nextPending++];
+
+        pthread_mutex_unlock(&poolLock);
+        evaluateStatement(stmt);
+        pthread_mutex_lock(&poolLock);
+
+        if( --unfinished == 0 ) {
+            pthread_cond_signal(&workDone);
+        }
+    }
+}
+
+
+static void * workerLoop(void * unused) {
+
+    (void) unused;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&poolLock);
+
+    while( true ) {
+
+        while( generation == seen && ! shuttingDown ) {
+            pthread_cond_wait(&workReady, &poolLock);
+        }
+
+        if( shuttingDown ) {
+            break;
+        }
+
+        seen = generation;
+        drainPending();
+    }
+
+    pthread_mutex_unlock(&poolLock);
+
+    return NULL;
+}
+
+
+static void evaluateLevel(batchStatement ** stmts, int count) {
+
+    pthread_mutex_lock(&poolLock);
+
+    pending = stmts;
+    pendingCount = count;
+    nextPending = 0;
+    unfinished = count;
+    ++generation;
+    pthread_cond_broadcast(&workReady);
+
+    // The main thread works through the level too
+    drainPending();
+
+    while( unfinished > 0 ) {
+        pthread_cond_wait(&workDone, &poolLock);
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+
+static void commitStatement(batchStatement * stmt) {
+
+    setThreadOutput(stmt->stream);
+
+    if( stmt->access.evaluate ) {
+        minimatCommitResult(stmt->ans);
+    } else {
+        minimatExecuteCmd(stmt->cmd);
+    }
+
+    setThreadOutput(NULL);
+}
+
+
+/**
+ * Runs a window of statements and prints their output in program order
+ */
+static void runWindow(batchStatement * window, int count) {
+
+    int numLevels = 0;
+
+    for(int i = 0; i < count; ++i) {
+        batchStatement * stmt = &window[i];
+
+        stmt->stream = open_memstream(&stmt->output, &stmt->outputLen);
+        stmt->level = 0;
+
+        for(int j = 0; j < i; ++j) {
+            int lowest = lowestLevel(&window[j], stmt);
+
+            if( lowest > stmt->level ) {
+                stmt->level = lowest;
+            }
+        }
+
+        if( stmt->level + 1 > numLevels ) {
+            numLevels = stmt->level + 1;
+        }
+    }
+
+    batchStatement * levelStmts[BATCH_WINDOW];
+
+    for(int level = 0; level < numLevels; ++level) {
+
+        int levelCount = 0;
+
+        for(int i = 0; i < count; ++i) {
+            if( window[i].level == level && window[i].access.evaluate ) {
+                levelStmts[levelCount++] = &window[i];
+            }
+        }
+
+        if( levelCount > 1 && numWorkers > 0 ) {
+            evaluateLevel(levelStmts, levelCount);
+        } else {
+            for(int i = 0; i < levelCount; ++i) {
+                evaluateStatement(levelStmts[i]);
+            }
+        }
+
+        for(int i = 0; i < count; ++i) {
+            if( window[i].level == level ) {
+                commitStatement(&window[i]);
+            }
+        }
+    }
+
+    for(int i = 0; i < count; ++i) {
+        fclose(window[i].stream);
+        fwrite(window[i].output, 1, window[i].outputLen, stdout);
+        free(window[i].output);
+    }
+
+    fflush(stdout);
+}
+
+
+static void startWorkers(int numThreads) {
+
+    // The main thread is one of the threads
+    for(int i = 0; i < numThreads - 1 && i < MAX_BATCH_THREADS; ++i) {
+        if( pthread_create(&workers[numWorkers], NULL, workerLoop, NULL) == 0 ) {
+            ++numWorkers;
+        }
+    }
+}
+
+
+static void stopWorkers( void ) {
+
+    pthread_mutex_lock(&poolLock);
+    shuttingDown = true;
+    pthread_cond_broadcast(&workReady);
+    pthread_mutex_unlock(&poolLock);
+
+    for(int i = 0; i < numWorkers; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+    numWorkers = 0;
+    shuttingDown = false;
+}
+
+
+void runBatch( FILE * input, int numThreads ) {
+
+    static batchStatement window[BATCH_WINDOW];
+    int count = 0;
+
+    char inputBuffer[INPUT_BUFFER_SIZE];
+
+    startWorkers(numThreads);
+
+    while( fgets(inputBuffer, sizeof(inputBuffer), input) != NULL ) {
+
+        // remove trailing newline character to prevent bugs
+        inputBuffer[strcspn(inputBuffer, "\n")] = '\0';
+
+        if( strcmp(inputBuffer, EXIT_SYMBOL) == 0 ) {
+            break;
+        }
+
+        // Blocks run on their own, in order, like a barrier
+        if( isBlockStart(inputBuffer) ) {
+            runWindow(window, count);
+            count = 0;
+
+            scriptBlock * block = compileBlock(inputBuffer, input);
+
+            if( block != NULL ) {
+                runBlock(block);
+                freeBlock(block);
+            }
+
+            fflush(stdout);
+            continue;
+        }
+
+        minimatcmd cmd = minimatProcessCmd(&inputBuffer[0]);
+
+        // Statements already overlap here, "&" adds nothing
+        cmd.background = false;
+
+        if( isBarrier(cmd) ) {
+            runWindow(window, count);
+            count = 0;
+
+            minimatExecuteCmd(cmd);
+            fflush(stdout);
+            continue;
+        }
+
+        window[count].cmd = cmd;
+        classifyCommand(&window[count].cmd, &window[count].access);
+
+        if( ++count == BATCH_WINDOW ) {
+            runWindow(window, count);
+            count = 0;
+        }
+    }
+
+    runWindow(window, count);
+
+    stopWorkers();
+}
@@ -0,0 +1,280 @@
+/**
+ * @file compress.c
+ * @brief Lossless Gorilla-style compression of vector files
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - The first value is stored whole, every later one as the XOR with
+ *    the value before it
+ *    - A zero XOR (repeated value) is a single 0 bit
+ *    - Otherwise 1, then 0 if the XOR's set bits fit in the previous
+ *      window and only the window is written, or 1 plus 5 bits of
+ *      leading zeros, 6 bits of width and the new window
+ *  - Slowly changing data (ramps, constants, sensor readings) shares
+ *    most of its high bits, so the windows stay narrow
+ *  - The stream is written MSB first in 64-bit words after a header of
+ *    magic number and element count
+ *  - verifyCompressed decodes a copy against its raw file before the raw
+ *    file is trusted to be redundant
+ */
+
+#include "compress.h"
+#include <string.h>
+
+// Leading zero counts are stored in 5 bits
+#define MAX_LEADING 31
+#define BITS_PER_WORD 64
+
+typedef struct {
+
+    FILE * out;
+    uint64_t word;
+    int bitsUsed;
+    size_t bytes;
+
+} bitWriter;
+
+
+static void writeBits(bitWriter * writer, uint64_t bits, int count) {
+
+    while( count > 0 ) {
+        int room = BITS_PER_WORD - writer->bitsUsed;
+        int take = ( count < room ) ? count : room;
+        uint64_t chunk = ( bits >> ( count - take ) ) & ( ( take == BITS_PER_WORD ) ? ~0ULL : ( ( 1ULL << take ) - 1 ) );
+
+        writer->word = ( take == BITS_PER_WORD ) ? chunk : ( writer->word << take ) | chunk;
+        writer->bitsUsed += take;
+        count -= take;
+
+        if( writer->bitsUsed == BITS_PER_WORD ) {
+            fwrite(&writer->word, sizeof(writer->word), 1, writer->out);
+            writer->bytes += sizeof(writer->word);
+            writer->word = 0;
+            writer->bitsUsed = 0;
+        }
+    }
+}
+
+
+static void flushBits(bitWriter * writer) {
+
+    if( writer->bitsUsed > 0 ) {
+        writeBits(writer, 0, BITS_PER_WORD - writer->bitsUsed);
+    }
+}
+
+
+static void encodeValue(bitWriter * writer, uint64_t value, uint64_t * previous, int * leading, int * meaningful) {
+
+    uint64_t xor = value ^ *previous;
+    *previous = value;
+
+    if( xor == 0 ) {
+        writeBits(writer, 0, 1);
+        return;
+    }
+
+    int newLeading = __builtin_clzll(xor);
+    int trailing = __builtin_ctzll(xor);
+
+    if( newLeading > MAX_LEADING ) {
+        newLeading = MAX_LEADING;
+    }
+
+    // Reuse the previous window when the set bits fall inside it
+    if( *meaningful > 0 && newLeading >= *leading &&
+        trailing >= BITS_PER_WORD - *leading - *meaningful ) {
+        writeBits(writer, 0x2, 2);
+        writeBits(writer, xor >> ( BITS_PER_WORD - *leading - *meaningful ), *meaningful);
+        return;
+    }
+
+    *leading = newLeading;
+    *meaningful = BITS_PER_WORD - newLeading - trailing;
+
+    // A width of 64 does not fit in 6 bits and is written as 0
+    writeBits(writer, 0x3, 2);
+    writeBits(writer, *leading, 5);
+    writeBits(writer, *meaningful & 0x3F, 6);
+    writeBits(writer, xor >> trailing, *meaningful);
+}
+
+
+bool compressFile( const char * rawPath, size_t length, const char * packedPath, size_t * packedBytes ) {
+
+    FILE * in = fopen(rawPath, "rb");
+    FILE * out = fopen(packedPath, "wb");
+    bool ok = in != NULL && out != NULL;
+
+    uint32_t magic = COMPRESSED_MAGIC;
+    uint64_t count = length;
+
+    ok = ok && fwrite(&magic, sizeof(magic), 1, out) == 1 && fwrite(&count, sizeof(count), 1, out) == 1;
+
+    bitWriter writer = { .out = out, .bytes = sizeof(magic) + sizeof(count) };
+    uint64_t previous = 0;
+    int leading = 0;
+    int meaningful = 0;
+    double values[BITS_PER_WORD * 16];
+    size_t done = 0;
+
+    while( ok && done < length ) {
+
+        size_t want = length - done;
+        if( want > sizeof(values) / sizeof(values[0]) ) {
+            want = sizeof(values) / sizeof(values[0]);
+        }
+
+        ok = fread(values, sizeof(double), want, in) == want;
+
+        for(size_t i = 0; ok && i < want; ++i) {
+            uint64_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+
+            if( done + i == 0 ) {
+                writeBits(&writer, bits, BITS_PER_WORD);
+                previous = bits;
+            } else {
+                encodeValue(&writer, bits, &previous, &leading, &meaningful);
+            }
+        }
+
+        done += want;
+    }
+
+    if( ok ) {
+        flushBits(&writer);
+    }
+
+    if( in != NULL ) fclose(in);
+    if( out != NULL && fclose(out) != 0 ) ok = false;
+
+    *packedBytes = writer.bytes;
+
+    return ok;
+}
+
+
+static uint64_t readBits(gorillaDecoder * decoder, int count) {
+
+    uint64_t result = 0;
+
+    while( count > 0 ) {
+
+        if( decoder->bitsLeft == 0 ) {
+            if( fread(&decoder->word, sizeof(decoder->word), 1, decoder->in) != 1 ) {
+                decoder->word = 0;
+            }
+            decoder->bitsLeft = BITS_PER_WORD;
+        }
+
+        int take = ( count < decoder->bitsLeft ) ? count : decoder->bitsLeft;
+        uint64_t chunk = ( take == BITS_PER_WORD ) ? decoder->word : decoder->word >> ( BITS_PER_WORD - take );
+
+        result = ( take == BITS_PER_WORD ) ? chunk : ( result << take ) | chunk;
+        decoder->word = ( take == BITS_PER_WORD ) ? 0 : decoder->word << take;
+        decoder->bitsLeft -= take;
+        count -= take;
+    }
+
+    return result;
+}
+
+
+bool openDecoder( gorillaDecoder * decoder, const char * packedPath ) {
+
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->in = fopen(packedPath, "rb");
+
+    uint32_t magic = 0;
+    uint64_t count = 0;
+
+    if( decoder->in == NULL ) {
+        return false;
+    }
+
+    if( fread(&magic, sizeof(magic), 1, decoder->in) != 1 || magic != COMPRESSED_MAGIC ||
+        fread(&count, sizeof(count), 1, decoder->in) != 1 ) {
+        closeDecoder(decoder);
+        return false;
+    }
+
+    decoder->remaining = count;
+
+    return true;
+}
+
+
+void decodeValues( gorillaDecoder * decoder, double * out, size_t count ) {
+
+    for(size_t i = 0; i < count && decoder->remaining > 0; ++i, --decoder->remaining) {
+
+        if( ! decoder->started ) {
+            decoder->previous = readBits(decoder, BITS_PER_WORD);
+            decoder->started = true;
+        } else if( readBits(decoder, 1) != 0 ) {
+
+            if( readBits(decoder, 1) != 0 ) {
+                decoder->leading = (int) readBits(decoder, 5);
+                decoder->meaningful = (int) readBits(decoder, 6);
+
+                if( decoder->meaningful == 0 ) {
+                    decoder->meaningful = BITS_PER_WORD;
+                }
+            }
+
+            int trailing = BITS_PER_WORD - decoder->leading - decoder->meaningful;
+            decoder->previous ^= readBits(decoder, decoder->meaningful) << trailing;
+        }
+
+        memcpy(&out[i], &decoder->previous, sizeof(double));
+    }
+}
+
+
+void closeDecoder( gorillaDecoder * decoder ) {
+
+    if( decoder->in != NULL ) {
+        fclose(decoder->in);
+        decoder->in = NULL;
+    }
+}
+
+
+bool verifyCompressed( const char * rawPath, size_t length, const char * packedPath ) {
+
+    gorillaDecoder decoder = { .in = NULL };
+    FILE * in = fopen(rawPath, "rb");
+    bool ok = in != NULL && openDecoder(&decoder, packedPath) && decoder.remaining == length;
+
+    double raw[BITS_PER_WORD * 16];
+    double decoded[BITS_PER_WORD * 16];
+    size_t done = 0;
+
+    while( ok && done < length ) {
+
+        size_t want = length - done;
+        if( want > sizeof(raw) / sizeof(raw[0]) ) {
+            want = sizeof(raw) / sizeof(raw[0]);
+        }
+
+        ok = fread(raw, sizeof(double), want, in) == want;
+
+        if( ok ) {
+            decodeValues(&decoder, decoded, want);
+            // Bit for bit, so NaN payloads and negative zeros count too
+            ok = memcmp(raw, decoded, want * sizeof(double)) == 0;
+        }
+
+        done += want;
+    }
+
+    if( in != NULL ) fclose(in);
+    closeDecoder(&decoder);
+
+    return ok;
+}
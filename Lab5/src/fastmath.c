@@ -0,0 +1,329 @@
+/**
+ * @file fastmath.c
+ * @brief Vectorizable approximations of sqrt, exp, log, sin, cos and tanh
+ * for "fastmath on"
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Algorithm:
+ *  - Every function is straight-line arithmetic on one element with no
+ *    branches or calls, so a loop over a block of them vectorizes
+ *    - Integers needed from a double (2^k, the quadrant) are read out of
+ *      the bits of x * c + 1.5 * 2^52, which rounds to an integer in
+ *      its low bits without a conversion instruction
+ *  - exp: x = k ln 2 + r with |r| <= ln 2 / 2, e^r by its Taylor series
+ *    to r^13, scaled by 2^k built in the exponent bits
+ *  - log: x = m 2^e with m in [sqrt(1/2), sqrt(2)), log m = 2 atanh(s)
+ *    for s = (m - 1) / (m + 1), a series in s^2 to s^20
+ *  - sin, cos: x = k pi/2 + r with pi/2 split into four parts (exact
+ *    products while |k| < 2^20), both Taylor series on r, and the
+ *    quadrant k mod 4 picks one and its sign
+ *  - tanh: t = e^2|x| - 1 the same way as exp, keeping the - 1 inside
+ *    the reduction, then t / (t + 2) with the sign of x
+ *  - Inputs outside what a function handles (NaN, infinities, overflow,
+ *    log of non-normal numbers, large trig arguments) are recomputed by
+ *    libm in a second pass over the block, so only the bound in
+ *    fastmath.h applies to the rest
+ *  - sqrt and abs are exact, they only lose errno and vectorize
+ */
+
+#include "fastmath.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// x * c + SHIFTER leaves round(x * c) in the low bits of the result
+#define SHIFTER 6755399441055744.0
+#define TWO_POW_52 4503599627370496.0
+#define TWO_POW_52_BITS 0x4330000000000000ULL
+#define EXPONENT_BIAS 1023
+#define MANTISSA_BITS 52
+#define MANTISSA_MASK 0x000FFFFFFFFFFFFFULL
+#define ONE_BITS 0x3FF0000000000000ULL
+#define SIGN_BIT 0x8000000000000000ULL
+
+#define LOG2E 1.4426950408889634
+#define SQRT2 1.4142135623730951
+#define TWO_OVER_PI 0.63661977236758134
+
+// ln 2 and pi/2 split so k times the leading parts is exact
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define PIO2_1 1.57079632673412561417e+00
+#define PIO2_2 6.07710050630396597660e-11
+#define PIO2_3 2.02226624871116645580e-21
+#define PIO2_3T 8.47842766036889956997e-32
+
+// x86-64 machines with AVX2 and FMA run a copy built for them, 4 wide
+// with fused multiply-adds, chosen once when the program loads. Only
+// static functions are cloned, so the library exports nothing extra
+#if defined(__x86_64__) && defined(__GNUC__) && ! defined(__clang__)
+#define FASTMATH_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define FASTMATH_CLONES
+#endif
+
+// Beyond these exp overflows or leaves the normal numbers
+#define EXP_MIN -708.0
+#define EXP_MAX 709.0
+// tanh is exactly +-1 in doubles well before this
+#define TANH_SATURATE 20.0
+
+
+static inline uint64_t asBits(double d) {
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+
+    return bits;
+}
+
+
+static inline double asDouble(uint64_t bits) {
+
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+
+    return d;
+}
+
+
+// 2^k for k in the normal exponent range, from k's two's complement bits
+static inline double powerOfTwo(uint64_t k) {
+    return asDouble(( k + EXPONENT_BIAS ) << MANTISSA_BITS);
+}
+
+
+// e^r - 1 for |r| <= ln 2 / 2, Taylor series to r^14
+static inline double expm1Reduced(double r) {
+
+    double p = 1.0 / 87178291200.0;
+    p = p * r + 1.0 / 6227020800.0;
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+
+    return r + r * r * p;
+}
+
+
+static inline double expElement(double x) {
+
+    // NaN passes through both, it is fixed up with the rest
+    double xc = ( x < EXP_MIN ) ? EXP_MIN : x;
+    xc = ( xc > EXP_MAX ) ? EXP_MAX : xc;
+
+    double shifted = xc * LOG2E + SHIFTER;
+    double k = shifted - SHIFTER;
+    double r = ( xc - k * LN2_HI ) - k * LN2_LO;
+
+    return ( 1.0 + expm1Reduced(r) ) * powerOfTwo(asBits(shifted) - asBits(SHIFTER));
+}
+
+
+static inline double logElement(double x) {
+
+    uint64_t bits = asBits(x);
+    double m = asDouble(( bits & MANTISSA_MASK ) | ONE_BITS);
+    double high = ( m > SQRT2 ) ? 1.0 : 0.0;
+
+    // The biased exponent read as a double the same way as the shifter
+    double e = ( asDouble(TWO_POW_52_BITS | ( bits >> MANTISSA_BITS )) - TWO_POW_52 ) -
+               EXPONENT_BIAS + high;
+
+    m = ( m > SQRT2 ) ? m * 0.5 : m;
+
+    double f = m - 1.0;
+    double s = f / ( 2.0 + f );
+    double s2 = s * s;
+
+    double q = 1.0 / 21.0;
+    q = q * s2 + 1.0 / 19.0;
+    q = q * s2 + 1.0 / 17.0;
+    q = q * s2 + 1.0 / 15.0;
+    q = q * s2 + 1.0 / 13.0;
+    q = q * s2 + 1.0 / 11.0;
+    q = q * s2 + 1.0 / 9.0;
+    q = q * s2 + 1.0 / 7.0;
+    q = q * s2 + 1.0 / 5.0;
+    q = q * s2 + 1.0 / 3.0;
+
+    double logm = 2.0 * s + 2.0 * s * ( s2 * q );
+
+    return e * LN2_HI + ( e * LN2_LO + logm );
+}
+
+
+// sin r for |r| <= pi/4, Taylor series to r^17
+static inline double sinReduced(double r) {
+
+    double r2 = r * r;
+
+    double p = 1.0 / 355687428096000.0;
+    p = p * r2 - 1.0 / 1307674368000.0;
+    p = p * r2 + 1.0 / 6227020800.0;
+    p = p * r2 - 1.0 / 39916800.0;
+    p = p * r2 + 1.0 / 362880.0;
+    p = p * r2 - 1.0 / 5040.0;
+    p = p * r2 + 1.0 / 120.0;
+    p = p * r2 - 1.0 / 6.0;
+
+    return r + r * r2 * p;
+}
+
+
+// cos r for |r| <= pi/4, Taylor series to r^18
+static inline double cosReduced(double r) {
+
+    double r2 = r * r;
+
+    double p = -1.0 / 6402373705728000.0;
+    p = p * r2 + 1.0 / 20922789888000.0;
+    p = p * r2 - 1.0 / 87178291200.0;
+    p = p * r2 + 1.0 / 479001600.0;
+    p = p * r2 - 1.0 / 3628800.0;
+    p = p * r2 + 1.0 / 40320.0;
+    p = p * r2 - 1.0 / 720.0;
+    p = p * r2 + 1.0 / 24.0;
+    p = p * r2 - 0.5;
+
+    return 1.0 + r2 * p;
+}
+
+
+/**
+ * sin x when shift is 0, cos x when it is 1, by way of the quadrant:
+ * cos x = sin(x + pi/2)
+ */
+static inline double trigElement(double x, uint64_t shift) {
+
+    double shifted = x * TWO_OVER_PI + SHIFTER;
+    double k = shifted - SHIFTER;
+    double r = ( ( ( x - k * PIO2_1 ) - k * PIO2_2 ) - k * PIO2_3 ) - k * PIO2_3T;
+
+    // Odd quadrants take cos, chosen with a mask since SSE2 can't compare
+    // 64 bit integers. Quadrants 2 and 3 are the negatives of 0 and 1
+    uint64_t quadrant = ( asBits(shifted) + shift ) & 3;
+    uint64_t takeCos = 0 - ( quadrant & 1 );
+    uint64_t result = ( asBits(cosReduced(r)) & takeCos ) | ( asBits(sinReduced(r)) & ~takeCos );
+
+    return asDouble(result ^ ( ( quadrant & 2 ) << 62 ));
+}
+
+
+static inline double tanhElement(double x) {
+
+    double a = fabs(x);
+    a = ( a > TANH_SATURATE ) ? TANH_SATURATE : a;
+
+    double y = 2.0 * a;
+    double shifted = y * LOG2E + SHIFTER;
+    double k = shifted - SHIFTER;
+    double r = ( y - k * LN2_HI ) - k * LN2_LO;
+    double scale = powerOfTwo(asBits(shifted) - asBits(SHIFTER));
+
+    // e^y - 1 = 2^k (e^r - 1) + (2^k - 1), no cancellation for y >= 0
+    double t = scale * expm1Reduced(r) + ( scale - 1.0 );
+    double result = t / ( t + 2.0 );
+
+    return asDouble(asBits(result) | ( asBits(x) & SIGN_BIT ));
+}
+
+
+static inline bool expHandles(double x) {
+    return x >= EXP_MIN && x <= EXP_MAX;
+}
+
+
+static inline bool logHandles(double x) {
+    return x >= DBL_MIN && x <= DBL_MAX;
+}
+
+
+static inline bool trigHandles(double x) {
+    return fabs(x) <= FAST_TRIG_MAX;
+}
+
+
+static inline bool tanhHandles(double x) {
+    return x == x;
+}
+
+
+/**
+ * Defines fast<name>: each block is computed into a buffer, the inputs
+ * the approximation doesn't handle are redone by libm, and the buffer is
+ * copied out, so in and out may overlap
+ */
+#define DEFINE_FAST(name, element, handles, libmFn)                            \
+static FASTMATH_CLONES void name##Blocks( const double * in, double * out, size_t count ) { \
+                                                                               \
+    double block[FASTMATH_BLOCK];                                              \
+                                                                               \
+    for(size_t first = 0; first < count; first += FASTMATH_BLOCK) {            \
+        size_t n = ( count - first < FASTMATH_BLOCK ) ? count - first : FASTMATH_BLOCK; \
+        const double * x = in + first;                                         \
+                                                                               \
+        for(size_t i = 0; i < n; ++i) {                                        \
+            block[i] = element;                                                \
+        }                                                                      \
+                                                                               \
+        for(size_t i = 0; i < n; ++i) {                                        \
+            if( ! handles(x[i]) ) {                                            \
+                block[i] = libmFn(x[i]);                                       \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        memcpy(out + first, block, n * sizeof(double));                        \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+void fast##name( const double * in, double * out, size_t count ) {             \
+    name##Blocks(in, out, count);                                              \
+}
+
+DEFINE_FAST(Exp, expElement(x[i]), expHandles, exp)
+DEFINE_FAST(Log, logElement(x[i]), logHandles, log)
+DEFINE_FAST(Sin, trigElement(x[i], 0), trigHandles, sin)
+DEFINE_FAST(Cos, trigElement(x[i], 1), trigHandles, cos)
+DEFINE_FAST(Tanh, tanhElement(x[i]), tanhHandles, tanh)
+
+
+// Correctly rounded already, built without errno the loop vectorizes
+static FASTMATH_CLONES void sqrtBlocks( const double * in, double * out, size_t count ) {
+
+    for(size_t i = 0; i < count; ++i) {
+        out[i] = sqrt(in[i]);
+    }
+}
+
+
+static FASTMATH_CLONES void absBlocks( const double * in, double * out, size_t count ) {
+
+    for(size_t i = 0; i < count; ++i) {
+        out[i] = fabs(in[i]);
+    }
+}
+
+
+void fastSqrt( const double * in, double * out, size_t count ) {
+    sqrtBlocks(in, out, count);
+}
+
+
+void fastAbs( const double * in, double * out, size_t count ) {
+    absBlocks(in, out, count);
+}
@@ -0,0 +1,222 @@
+/**
+ * @file jit.c
+ * @brief Compiles element-wise vector operations to x86-64 SSE2 code
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Look up the kernel for (operation, vector size) in the cache
+ *  - The first lookup emits every kernel, a fully unrolled loop each,
+ *    into a fresh code page
+ *    - Pairs of elements use packed instructions, an odd tail a scalar one
+ *  - The page is made executable before any kernel is published and is
+ *    never writable again, so no thread can be running code on it while
+ *    it changes
+ */
+
+#include "jit.h"
+#include "vector.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+#define JIT_CODE_SIZE 4096
+
+// Instruction prefixes selecting packed or scalar double precision
+#define PACKED_DOUBLE 0x66
+#define SCALAR_DOUBLE 0xF2
+
+// Opcodes following the 0x0F escape byte
+#define OP_LOAD    0x10
+#define OP_STORE   0x11
+#define OP_UNPCKL  0x14
+#define OP_ADD     0x58
+#define OP_MUL     0x59
+#define OP_SUB     0x5C
+#define OP_RET     0xC3
+
+// ModRM bytes, System V passes a, b and out in rdi, rsi and rdx
+#define MODRM_XMM0_RDI_DISP8 0x47
+#define MODRM_XMM0_RDX_DISP8 0x42
+#define MODRM_XMM1_RSI_DISP8 0x4E
+#define MODRM_XMM1_RSI       0x0E
+#define MODRM_XMM1_XMM1      0xC9
+#define MODRM_XMM0_XMM1      0xC1
+
+// Filled all at once on first use, so batch workers can share it
+static jitKernel kernelCache[JIT_NUM_OPS][MAX_VECTOR_DIMENSION + 1];
+static pthread_mutex_t compileLock = PTHREAD_MUTEX_INITIALIZER;
+static bool compiled = false;
+static bool enabled = JIT_AVAILABLE;
+static bool pageFailed = false;
+
+
+bool jitSupported( void ) {
+    return JIT_AVAILABLE && ! __atomic_load_n(&pageFailed, __ATOMIC_RELAXED);
+}
+
+
+bool jitEnabled( void ) {
+    return enabled && jitSupported();
+}
+
+
+void setJitEnabled( bool on ) {
+    enabled = on;
+}
+
+
+#if JIT_AVAILABLE
+
+static size_t emit(uint8_t * code, size_t at, uint8_t prefix, uint8_t opcode, uint8_t modrm) {
+
+    code[at++] = prefix;
+    code[at++] = 0x0F;
+    code[at++] = opcode;
+    code[at++] = modrm;
+
+    return at;
+}
+
+
+static size_t emitDisp(uint8_t * code, size_t at, uint8_t prefix, uint8_t opcode,
+                       uint8_t modrm, int disp) {
+
+    at = emit(code, at, prefix, opcode, modrm);
+    code[at++] = (uint8_t) disp;
+
+    return at;
+}
+
+
+/**
+ * Writes the unrolled kernel into code and returns its length in bytes
+ */
+static size_t emitKernel(uint8_t * code, jitOperation op, int vecSize) {
+
+    static const uint8_t arithmetic[JIT_NUM_OPS] = {
+        [JIT_ADD] = OP_ADD,
+        [JIT_SUB] = OP_SUB,
+        [JIT_SCALE] = OP_MUL,
+    };
+
+    size_t at = 0;
+
+    // Broadcast the scalar into both lanes of xmm1
+    if( op == JIT_SCALE ) {
+        at = emit(code, at, SCALAR_DOUBLE, OP_LOAD, MODRM_XMM1_RSI);
+        at = emit(code, at, PACKED_DOUBLE, OP_UNPCKL, MODRM_XMM1_XMM1);
+    }
+
+    for(int i = 0; i < vecSize; ) {
+
+        uint8_t width = ( vecSize - i >= 2 ) ? PACKED_DOUBLE : SCALAR_DOUBLE;
+        int disp = i * (int) sizeof(double);
+
+        at = emitDisp(code, at, width, OP_LOAD, MODRM_XMM0_RDI_DISP8, disp);
+
+        // Packed arithmetic on a memory operand faults unless it is 16 byte
+        // aligned, and vectors are only 8 byte aligned, so b is loaded first
+        if( op != JIT_SCALE ) {
+            at = emitDisp(code, at, width, OP_LOAD, MODRM_XMM1_RSI_DISP8, disp);
+        }
+
+        at = emit(code, at, width, arithmetic[op], MODRM_XMM0_XMM1);
+
+        at = emitDisp(code, at, width, OP_STORE, MODRM_XMM0_RDX_DISP8, disp);
+
+        i += ( width == PACKED_DOUBLE ) ? 2 : 1;
+    }
+
+    code[at++] = OP_RET;
+
+    return at;
+}
+
+
+/**
+ * Emits every kernel into a new page, then publishes them once the page
+ * is executable. Called once, under compileLock
+ */
+static void compileKernels(void) {
+
+    jitKernel kernels[JIT_NUM_OPS][MAX_VECTOR_DIMENSION + 1] = { { NULL } };
+    uint8_t scratch[256];
+    size_t used = 0;
+
+    uint8_t * page = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if( page == MAP_FAILED ) {
+        __atomic_store_n(&pageFailed, true, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for(int op = 0; op < JIT_NUM_OPS; ++op) {
+        for(int vecSize = 1; vecSize <= MAX_VECTOR_DIMENSION; ++vecSize) {
+            size_t len = emitKernel(scratch, (jitOperation) op, vecSize);
+
+            if( used + len <= JIT_CODE_SIZE ) {
+                memcpy(page + used, scratch, len);
+                kernels[op][vecSize] = (jitKernel) (void *) (page + used);
+                used += len;
+            }
+        }
+    }
+
+    // Some kernels refuse executable mappings, stay on the C loops then
+    if( mprotect(page, JIT_CODE_SIZE, PROT_READ | PROT_EXEC) != 0 ) {
+        munmap(page, JIT_CODE_SIZE);
+        __atomic_store_n(&pageFailed, true, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for(int op = 0; op < JIT_NUM_OPS; ++op) {
+        for(int vecSize = 1; vecSize <= MAX_VECTOR_DIMENSION; ++vecSize) {
+            __atomic_store_n(&kernelCache[op][vecSize], kernels[op][vecSize], __ATOMIC_RELEASE);
+        }
+    }
+}
+
+#endif /* JIT_AVAILABLE */
+
+
+jitKernel jitLookup( jitOperation op, int vecSize ) {
+
+    if( ! jitEnabled() || vecSize < 1 || vecSize > MAX_VECTOR_DIMENSION ) {
+        return NULL;
+    }
+
+#if JIT_AVAILABLE
+    jitKernel kernel = __atomic_load_n(&kernelCache[op][vecSize], __ATOMIC_ACQUIRE);
+
+    if( kernel == NULL ) {
+        pthread_mutex_lock(&compileLock);
+
+        if( ! compiled ) {
+            compileKernels();
+            compiled = true;
+        }
+
+        pthread_mutex_unlock(&compileLock);
+
+        kernel = __atomic_load_n(&kernelCache[op][vecSize], __ATOMIC_ACQUIRE);
+    }
+
+    return kernel;
+#else
+    (void) op;
+    return NULL;
+#endif
+}
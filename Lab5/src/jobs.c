@@ -0,0 +1,285 @@
+/**
+ * @file jobs.c
+ * @brief Commands run in the background with "&"
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - A job is a command that computes a result before storing it, a pure
+ *    evaluation or a file-backed operation
+ *  - Submitting copies the vectors the job reads into a snapshot workspace
+ *    (file-backed operands are copied by prepareMappedCmd) and starts a
+ *    thread on it, so the REPL takes the next command straight away
+ *  - A result that would be "ans" is stored as "job<id>" instead, so the
+ *    foreground keeps its own ans
+ *  - Before every command, finished jobs are stored and any pending job
+ *    the command conflicts with, by the read and write sets -j uses, is
+ *    waited for first. Commands that run alone under -j wait for all
+ *  - Only the main thread stores results, whatever the job printed is
+ *    shown when it is stored
+ */
+
+#include "jobs.h"
+#include "batch.h"
+#include "mapped.h"
+#include "profile.h"
+#include "termcolors.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JOB_LINE_LEN ( 3 * MAX_VECTOR_NAME_LEN + 64 )
+
+typedef struct {
+
+    int id;
+    minimatcmd cmd;
+    commandAccess access; // points into cmd and resultName
+    char resultName[MAX_VECTOR_NAME_LEN];
+
+    // Exactly one is set, the snapshot for an evaluation or the task of
+    // a file-backed operation
+    workspace * snapshot;
+    mappedTask * task;
+
+    vector ans;
+    bool evaluated;
+    bool finished; // set by the job's thread once it is done
+
+    pthread_t thread;
+    bool threaded; // false if it had to run on the main thread
+    FILE * stream; // captures what the job prints
+    char * output;
+    size_t outputLen;
+
+} job;
+
+// Pending jobs in submission order
+static job * jobs[MAX_JOBS];
+static int numJobs = 0;
+static int nextJobId = 1;
+
+
+bool canRunInBackground( minimatcmd cmd ) {
+
+    // Counters only follow the main thread
+    if( runsAlone(cmd) || profilingEnabled() ) {
+        return false;
+    }
+
+    if( involvesMappedVectors(cmd) ) {
+        return true;
+    }
+
+    commandAccess access;
+    classifyCommand(&cmd, &access);
+
+    return access.evaluate;
+}
+
+
+static void * runJob(void * arg) {
+
+    job * j = arg;
+
+    setThreadOutput(j->stream);
+
+    if( j->task != NULL ) {
+        runMappedTask(j->task);
+    } else {
+        setThreadWorkspace(j->snapshot);
+        j->evaluated = minimatEvaluateCmd(j->cmd, &j->ans);
+        setThreadWorkspace(NULL);
+    }
+
+    setThreadOutput(NULL);
+    __atomic_store_n(&j->finished, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+
+static void describeJob(const job * j, char * line, size_t size, const char * state) {
+
+    int length = snprintf(line, size, "\t[%d] %-8s %s", j->id, state, commandName(j->cmd.operation));
+
+    for(int i = 0; i < j->access.numReads && length < (int) size; ++i) {
+        length += snprintf(line + length, size - length, " %s", j->access.reads[i]);
+    }
+}
+
+
+/**
+ * Waits for the job if it is still running, then stores its result and
+ * shows what it printed. Removes it from the pending list.
+ */
+static bool finishJob(int index) {
+
+    job * j = jobs[index];
+    char line[JOB_LINE_LEN];
+
+    if( j->threaded ) {
+        pthread_join(j->thread, NULL);
+    }
+
+    fclose(j->stream);
+
+    describeJob(j, line, sizeof(line), "done");
+    printMessage(line);
+    fwrite(j->output, 1, j->outputLen, stdout);
+
+    bool stored;
+
+    if( j->task != NULL ) {
+        stored = finishMappedTask(j->task);
+    } else {
+        if( j->evaluated && strcmp(j->ans.vecName, "ans") == 0 ) {
+            strcpy(j->ans.vecName, j->resultName);
+        }
+
+        stored = j->evaluated && minimatCommitResult(j->ans);
+        destroyWorkspace(j->snapshot);
+    }
+
+    free(j->output);
+    free(j);
+
+    // Keep submission order for the rest
+    memmove(&jobs[index], &jobs[index + 1], ( numJobs - index - 1 ) * sizeof(job *));
+    --numJobs;
+
+    return stored;
+}
+
+
+bool submitJob( minimatcmd cmd ) {
+
+    // Full, so make room by waiting for the oldest
+    if( numJobs == MAX_JOBS ) {
+        finishJob(0);
+    }
+
+    job * j = calloc(1, sizeof(job));
+
+    if( j == NULL ) {
+        printMessage(ANSI_COLOR_RED "Out of memory!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    j->id = nextJobId;
+    j->cmd = cmd;
+    j->stream = open_memstream(&j->output, &j->outputLen);
+    snprintf(j->resultName, MAX_VECTOR_NAME_LEN, JOB_RESULT_PREFIX "%d", j->id);
+
+    classifyCommand(&j->cmd, &j->access);
+
+    if( j->access.write != NULL && strcmp(j->access.write, "ans") == 0 ) {
+        j->access.write = j->resultName;
+    }
+
+    if( j->stream == NULL ) {
+        printMessage(ANSI_COLOR_RED "Out of memory!" ANSI_COLOR_RESET);
+    } else if( involvesMappedVectors(cmd) ) {
+        j->task = prepareMappedCmd(cmd, j->resultName);
+    } else {
+        j->snapshot = snapshotVectors(j->access.reads, j->access.numReads);
+    }
+
+    // prepareMappedCmd has said why it could not start
+    if( j->task == NULL && j->snapshot == NULL ) {
+        if( j->stream != NULL ) {
+            fclose(j->stream);
+            free(j->output);
+        }
+
+        free(j);
+        return false;
+    }
+
+    // Without a thread the job still runs, just not in the background
+    j->threaded = ( pthread_create(&j->thread, NULL, runJob, j) == 0 );
+
+    if( ! j->threaded ) {
+        runJob(j);
+    }
+
+    jobs[numJobs++] = j;
+    ++nextJobId;
+
+    char line[JOB_LINE_LEN];
+    snprintf(line, sizeof(line), ANSI_COLOR_GREEN "\t[%d] started" ANSI_COLOR_RESET, j->id);
+    printMessage(line);
+
+    return true;
+}
+
+
+void settleJobs( minimatcmd cmd ) {
+
+    // Listing and waiting only store what has finished already
+    bool listing = ( cmd.operation == LIST_JOBS || cmd.operation == WAIT_JOB );
+    bool waitAll = ! listing && runsAlone(cmd);
+
+    commandAccess access;
+    classifyCommand(&cmd, &access);
+
+    for(int i = 0; i < numJobs; ) {
+        job * j = jobs[i];
+
+        if( waitAll || __atomic_load_n(&j->finished, __ATOMIC_ACQUIRE) ||
+            ( ! listing && accessesConflict(&j->access, &access) ) ) {
+            finishJob(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+bool waitJob( int id ) {
+
+    // No id waits for every job
+    if( id == 0 ) {
+        bool stored = true;
+
+        while( numJobs > 0 ) {
+            stored = finishJob(0) && stored;
+        }
+
+        return stored;
+    }
+
+    for(int i = 0; i < numJobs; ++i) {
+        if( jobs[i]->id == id ) {
+            return finishJob(i);
+        }
+    }
+
+    // Stored already, once the next command found it finished
+    if( id > 0 && id < nextJobId ) {
+        return true;
+    }
+
+    printMessage(ANSI_COLOR_RED "No such job!" ANSI_COLOR_RESET);
+
+    return false;
+}
+
+
+void listJobs( void ) {
+
+    char line[JOB_LINE_LEN];
+
+    if( numJobs == 0 ) {
+        printMessage(ANSI_COLOR_BLUE "\tNo background jobs" ANSI_COLOR_RESET);
+    }
+
+    for(int i = 0; i < numJobs; ++i) {
+        describeJob(jobs[i], line, sizeof(line), "running");
+        printMessage(line);
+    }
+}
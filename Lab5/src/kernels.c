@@ -0,0 +1,126 @@
+/**
+ * @file kernels.c
+ * @brief Fully unrolled element-wise kernels for every vector size
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - UNROLL_n expands a per-element statement for elements 0 to n - 1
+ *  - DEFINE_KERNELS(n) stamps out the add, sub, scale, axpy and dot kernels for
+ *    size n, and the tables map each size to its kernels
+ *  - Callers index the tables by vecSize once instead of looping
+ *  - Longer runs (mapped windows) go KERNEL_MAX_SIZE elements per call,
+ *    the kernel for the size of what is left finishing them
+ */
+
+#include "kernels.h"
+
+#define UNROLL_0(STEP)
+#define UNROLL_1(STEP) STEP(0)
+#define UNROLL_2(STEP) UNROLL_1(STEP) STEP(1)
+#define UNROLL_3(STEP) UNROLL_2(STEP) STEP(2)
+#define UNROLL_4(STEP) UNROLL_3(STEP) STEP(3)
+#define UNROLL_5(STEP) UNROLL_4(STEP) STEP(4)
+#define UNROLL_6(STEP) UNROLL_5(STEP) STEP(5)
+#define UNROLL_7(STEP) UNROLL_6(STEP) STEP(6)
+#define UNROLL_8(STEP) UNROLL_7(STEP) STEP(7)
+#define UNROLL_9(STEP) UNROLL_8(STEP) STEP(8)
+#define UNROLL_10(STEP) UNROLL_9(STEP) STEP(9)
+#define UNROLL_11(STEP) UNROLL_10(STEP) STEP(10)
+#define UNROLL_12(STEP) UNROLL_11(STEP) STEP(11)
+#define UNROLL_13(STEP) UNROLL_12(STEP) STEP(12)
+#define UNROLL_14(STEP) UNROLL_13(STEP) STEP(13)
+#define UNROLL_15(STEP) UNROLL_14(STEP) STEP(14)
+#define UNROLL_16(STEP) UNROLL_15(STEP) STEP(15)
+
+#define ADD_STEP(i) out[i] = a[i] + b[i];
+#define SUB_STEP(i) out[i] = a[i] - b[i];
+#define SCALE_STEP(i) out[i] = a[i] * scalar;
+#define AXPY_STEP(i) out[i] += scalar * a[i];
+#define DOT_STEP(i) + a[i] * b[i]
+
+#define DEFINE_KERNELS(n) \
+    static void add##n(const double * a, const double * b, double * out) { \
+        (void) a; (void) b; (void) out; \
+        UNROLL_##n(ADD_STEP) \
+    } \
+    static void sub##n(const double * a, const double * b, double * out) { \
+        (void) a; (void) b; (void) out; \
+        UNROLL_##n(SUB_STEP) \
+    } \
+    static void scale##n(const double * a, const double * b, double * out) { \
+        const double scalar = *b; \
+        (void) a; (void) scalar; (void) out; \
+        UNROLL_##n(SCALE_STEP) \
+    } \
+    static void axpy##n(const double * a, const double * b, double * out) { \
+        const double scalar = *b; \
+        (void) a; (void) scalar; (void) out; \
+        UNROLL_##n(AXPY_STEP) \
+    } \
+    static double dot##n(const double * a, const double * b) { \
+        (void) a; (void) b; \
+        return 0.0 UNROLL_##n(DOT_STEP); \
+    }
+
+// One line per size up to KERNEL_MAX_SIZE, size 0 does nothing
+_Static_assert(KERNEL_MAX_SIZE == 16, "add kernels for the new sizes");
+_Static_assert(MAX_VECTOR_DIMENSION <= KERNEL_MAX_SIZE, "every vector size needs a kernel");
+
+DEFINE_KERNELS(0)
+DEFINE_KERNELS(1)
+DEFINE_KERNELS(2)
+DEFINE_KERNELS(3)
+DEFINE_KERNELS(4)
+DEFINE_KERNELS(5)
+DEFINE_KERNELS(6)
+DEFINE_KERNELS(7)
+DEFINE_KERNELS(8)
+DEFINE_KERNELS(9)
+DEFINE_KERNELS(10)
+DEFINE_KERNELS(11)
+DEFINE_KERNELS(12)
+DEFINE_KERNELS(13)
+DEFINE_KERNELS(14)
+DEFINE_KERNELS(15)
+DEFINE_KERNELS(16)
+
+#define KERNEL_TABLE(kind) { \
+    kind##0, kind##1, kind##2, kind##3, kind##4, kind##5, kind##6, kind##7, kind##8, \
+    kind##9, kind##10, kind##11, kind##12, kind##13, kind##14, kind##15, kind##16 }
+
+const vectorKernel addKernels[KERNEL_MAX_SIZE + 1] = KERNEL_TABLE(add);
+const vectorKernel subKernels[KERNEL_MAX_SIZE + 1] = KERNEL_TABLE(sub);
+const vectorKernel scaleKernels[KERNEL_MAX_SIZE + 1] = KERNEL_TABLE(scale);
+const vectorKernel axpyKernels[KERNEL_MAX_SIZE + 1] = KERNEL_TABLE(axpy);
+const reductionKernel dotKernels[KERNEL_MAX_SIZE + 1] = KERNEL_TABLE(dot);
+
+
+void runKernels( const vectorKernel * table, const double * a, const double * b, double * out, size_t count ) {
+
+    // scale and axpy read one scalar through b, the others a second array
+    size_t bStep = ( table == scaleKernels || table == axpyKernels ) ? 0 : KERNEL_MAX_SIZE;
+    size_t done = 0;
+
+    for(; count - done >= KERNEL_MAX_SIZE; done += KERNEL_MAX_SIZE, b += bStep) {
+        table[KERNEL_MAX_SIZE](a + done, b, out + done);
+    }
+
+    table[count - done](a + done, b, out + done);
+}
+
+
+double runReduction( const reductionKernel * table, const double * a, const double * b, size_t count ) {
+
+    double total = 0.0;
+    size_t done = 0;
+
+    for(; count - done >= KERNEL_MAX_SIZE; done += KERNEL_MAX_SIZE) {
+        total += table[KERNEL_MAX_SIZE](a + done, b + done);
+    }
+
+    return total + table[count - done](a + done, b + done);
+}
@@ -0,0 +1,507 @@
+/**
+ * @file kmeans.c
+ * @brief k-means clustering of stored vectors
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - "kmeans k [names...] [> path]" packs the vectors (packed.c) and
+ *    picks k starting centers with k-means++ from the shared generator
+ *  - Lloyd iterations use Hamerly's bounds: an upper bound on the
+ *    distance to the assigned center and a lower bound on the distance
+ *    to every other center. A vector whose upper bound is below both its
+ *    lower bound and half the gap from its center to the nearest other
+ *    center can't change cluster, so its distances are skipped
+ *  - When a center moves the bounds are loosened by how far it moved
+ *  - Large inputs split each pass across threads, each with its own sums
+ *  - Stops when no vector changes cluster, then stores the centroids
+ *    and reports iterations per second and the distances pruned
+ */
+
+#include "kmeans.h"
+#include "packed.h"
+#include "random.h"
+#include "termcolors.h"
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KMEANS_LINE_LEN 160
+
+typedef struct {
+
+    const packedVectors * points;
+    int k;
+    double (* centers)[MAX_VECTOR_DIMENSION];
+    double * halfGap; // half the distance from each center to its nearest other
+    double * drift; // how far each center moved last iteration
+    double maxDrift; // largest drift and the center it belongs to
+    int maxDriftCenter;
+    double secondDrift; // largest drift among the other centers
+    bool first; // first pass, every distance is computed
+    int * labels;
+    double * upper;
+    double * lower;
+
+} kmeansJob;
+
+// One thread's share of a pass
+typedef struct {
+
+    kmeansJob * job;
+    int start;
+    int end;
+    double (* sums)[MAX_VECTOR_DIMENSION];
+    int * counts;
+    long long evaluations;
+    int changed;
+
+} kmeansPart;
+
+
+static double centerDistance(const kmeansJob * job, int i, int c) {
+
+    double sum = 0.0;
+
+    for(int d = 0; d < job->points->dims; ++d) {
+        double diff = job->points->coords[d][i] - job->centers[c][d];
+        sum += diff * diff;
+    }
+
+    return sqrt(sum);
+}
+
+
+/**
+ * Finds the closest and second closest center to vector i
+ */
+static void scanCenters(kmeansPart * part, int i) {
+
+    kmeansJob * job = part->job;
+    int best = 0;
+    double bestDist = DBL_MAX;
+    double secondDist = DBL_MAX;
+
+    for(int c = 0; c < job->k; ++c) {
+
+        double dist = ( ! job->first && c == job->labels[i] ) ? job->upper[i] : centerDistance(job, i, c);
+
+        if( job->first || c != job->labels[i] ) {
+            ++part->evaluations;
+        }
+
+        if( dist < bestDist ) {
+            secondDist = bestDist;
+            bestDist = dist;
+            best = c;
+        } else if( dist < secondDist ) {
+            secondDist = dist;
+        }
+    }
+
+    if( job->first || best != job->labels[i] ) {
+        ++part->changed;
+    }
+
+    job->labels[i] = best;
+    job->upper[i] = bestDist;
+    job->lower[i] = secondDist;
+}
+
+
+/**
+ * Loosens the bounds of vector i by how far the centers moved, then
+ * checks whether they still rule out a closer center
+ */
+static bool boundsHold(kmeansPart * part, int i) {
+
+    kmeansJob * job = part->job;
+    int label = job->labels[i];
+
+    job->upper[i] += job->drift[label];
+    job->lower[i] -= ( label == job->maxDriftCenter ) ? job->secondDrift : job->maxDrift;
+
+    double bound = ( job->halfGap[label] > job->lower[i] ) ? job->halfGap[label] : job->lower[i];
+
+    if( job->upper[i] <= bound ) {
+        return true;
+    }
+
+    // Tighten the upper bound before looking at the others
+    job->upper[i] = centerDistance(job, i, label);
+    ++part->evaluations;
+
+    return job->upper[i] <= bound;
+}
+
+
+static void * assignPart(void * arg) {
+
+    kmeansPart * part = arg;
+    kmeansJob * job = part->job;
+    const packedVectors * points = job->points;
+
+    for(int i = part->start; i < part->end; ++i) {
+
+        if( job->first || ! boundsHold(part, i) ) {
+            scanCenters(part, i);
+        }
+
+        ++part->counts[job->labels[i]];
+
+        for(int d = 0; d < points->dims; ++d) {
+            part->sums[job->labels[i]][d] += points->coords[d][i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Runs one assignment pass, returns how many vectors changed cluster
+ */
+static int assignAll(kmeansJob * job, kmeansPart * parts, int numParts, long long * evaluations) {
+
+    pthread_t threads[MAX_KMEANS_THREADS];
+    bool started[MAX_KMEANS_THREADS] = { false };
+    int changed = 0;
+
+    for(int p = 0; p < numParts; ++p) {
+        memset(parts[p].sums, 0, job->k * sizeof(*parts[p].sums));
+        memset(parts[p].counts, 0, job->k * sizeof(*parts[p].counts));
+        parts[p].evaluations = 0;
+        parts[p].changed = 0;
+    }
+
+    // The calling thread takes the first part
+    for(int p = 1; p < numParts; ++p) {
+        started[p] = pthread_create(&threads[p], NULL, assignPart, &parts[p]) == 0;
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        if( p == 0 || ! started[p] ) {
+            assignPart(&parts[p]);
+        }
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        if( started[p] ) {
+            pthread_join(threads[p], NULL);
+        }
+
+        changed += parts[p].changed;
+        *evaluations += parts[p].evaluations;
+    }
+
+    return changed;
+}
+
+
+/**
+ * Moves every center to the mean of its vectors and records the drift
+ */
+static void moveCenters(kmeansJob * job, kmeansPart * parts, int numParts) {
+
+    int dims = job->points->dims;
+
+    job->maxDrift = 0.0;
+    job->secondDrift = 0.0;
+    job->maxDriftCenter = 0;
+
+    for(int c = 0; c < job->k; ++c) {
+
+        double sum[MAX_VECTOR_DIMENSION] = { 0.0 };
+        int count = 0;
+
+        for(int p = 0; p < numParts; ++p) {
+            count += parts[p].counts[c];
+
+            for(int d = 0; d < dims; ++d) {
+                sum[d] += parts[p].sums[c][d];
+            }
+        }
+
+        double drift = 0.0;
+
+        // An empty cluster keeps its center
+        for(int d = 0; count > 0 && d < dims; ++d) {
+            double moved = sum[d] / count;
+            drift += ( moved - job->centers[c][d] ) * ( moved - job->centers[c][d] );
+            job->centers[c][d] = moved;
+        }
+
+        job->drift[c] = sqrt(drift);
+
+        if( job->drift[c] > job->maxDrift ) {
+            job->secondDrift = job->maxDrift;
+            job->maxDrift = job->drift[c];
+            job->maxDriftCenter = c;
+        } else if( job->drift[c] > job->secondDrift ) {
+            job->secondDrift = job->drift[c];
+        }
+    }
+
+    for(int c = 0; c < job->k; ++c) {
+
+        double nearest = DBL_MAX;
+
+        for(int other = 0; other < job->k; ++other) {
+            if( other == c ) {
+                continue;
+            }
+
+            double dist = 0.0;
+            for(int d = 0; d < dims; ++d) {
+                dist += ( job->centers[c][d] - job->centers[other][d] ) * ( job->centers[c][d] - job->centers[other][d] );
+            }
+
+            if( dist < nearest ) {
+                nearest = dist;
+            }
+        }
+
+        job->halfGap[c] = 0.5 * sqrt(nearest);
+    }
+}
+
+
+/**
+ * k-means++: each next center is a vector picked with probability
+ * proportional to its squared distance from the nearest chosen center
+ */
+static void seedCenters(kmeansJob * job, double * nearest) {
+
+    const packedVectors * points = job->points;
+    int n = points->count;
+    int chosen = (int) ( nextUniform() * n );
+
+    for(int c = 0; c < job->k; ++c) {
+
+        for(int d = 0; d < points->dims; ++d) {
+            job->centers[c][d] = points->coords[d][chosen];
+        }
+
+        double total = 0.0;
+
+        for(int i = 0; i < n; ++i) {
+            double dist = centerDistance(job, i, c);
+
+            if( c == 0 || dist * dist < nearest[i] ) {
+                nearest[i] = dist * dist;
+            }
+
+            total += nearest[i];
+        }
+
+        // Every vector already sits on a center, so any will do
+        if( total == 0.0 ) {
+            chosen = (int) ( nextUniform() * n );
+            continue;
+        }
+
+        double target = nextUniform() * total;
+        chosen = n - 1;
+
+        for(int i = 0; i < n; ++i) {
+            target -= nearest[i];
+
+            if( target < 0.0 ) {
+                chosen = i;
+                break;
+            }
+        }
+    }
+}
+
+
+static bool writeLabels(const kmeansJob * job, const char * path) {
+
+    FILE * out = fopen(path, "w");
+
+    if( out == NULL ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not open the output file" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    for(int i = 0; i < job->points->count; ++i) {
+        fprintf(out, "%s %d\n", job->points->names[i], job->labels[i] + 1);
+    }
+
+    if( fclose(out) != 0 ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not write the output file" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    return true;
+}
+
+
+static bool storeCentroids(const kmeansJob * job) {
+
+    for(int c = 0; c < job->k; ++c) {
+        vector centroid = { .vecSize = job->points->dims };
+
+        snprintf(centroid.vecName, sizeof(centroid.vecName), CENTROID_PREFIX "%d", c + 1);
+        memcpy(centroid.magnitudes, job->centers[c], sizeof(centroid.magnitudes));
+
+        if( ! addVectorToMemoryList(centroid) ) {
+            return false;
+        }
+
+        printVector(centroid);
+    }
+
+    return true;
+}
+
+
+static double secondsSince(const struct timespec * start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+
+static bool cluster(kmeansJob * job, const char * path) {
+
+    int n = job->points->count;
+    int numParts = 1;
+
+    if( n >= KMEANS_PARALLEL_MIN ) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numParts = ( cpus > MAX_KMEANS_THREADS ) ? MAX_KMEANS_THREADS : ( cpus < 1 ) ? 1 : (int) cpus;
+    }
+
+    kmeansPart parts[MAX_KMEANS_THREADS];
+    bool allocated = true;
+
+    for(int p = 0; p < numParts; ++p) {
+        parts[p] = (kmeansPart) {
+            .job = job,
+            .start = (int) ( (long long) n * p / numParts ),
+            .end = (int) ( (long long) n * ( p + 1 ) / numParts ),
+            .sums = malloc(job->k * sizeof(*parts[p].sums)),
+            .counts = malloc(job->k * sizeof(*parts[p].counts)),
+        };
+        allocated = allocated && parts[p].sums != NULL && parts[p].counts != NULL;
+    }
+
+    bool succeeded = false;
+
+    if( ! allocated ) {
+        printMessage(ANSI_COLOR_RED "Not enough memory for kmeans" ANSI_COLOR_RESET);
+    } else {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        // job->upper is free until the first pass fills it
+        seedCenters(job, job->upper);
+
+        long long evaluations = 0;
+        int iterations = 0;
+
+        job->first = true;
+        assignAll(job, parts, numParts, &evaluations);
+        job->first = false;
+
+        while( iterations < KMEANS_MAX_ITERATIONS ) {
+            moveCenters(job, parts, numParts);
+            ++iterations;
+
+            if( assignAll(job, parts, numParts, &evaluations) == 0 ) {
+                break;
+            }
+        }
+
+        // Without pruning every pass, the first included, computes n * k
+        double unpruned = (double) n * job->k * ( iterations + 1 );
+        double elapsed = secondsSince(&start);
+
+        char line[KMEANS_LINE_LEN];
+        snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\tkmeans: %d vectors, %d clusters, %d iterations%s "
+                 "(%.0f iterations/s), %.1f%% of distances pruned" ANSI_COLOR_RESET,
+                 n, job->k, iterations, ( iterations == KMEANS_MAX_ITERATIONS ) ? " without converging" : "",
+                 iterations / ( elapsed > 0.0 ? elapsed : 1e-9 ), 100.0 * ( 1.0 - evaluations / unpruned ));
+
+        succeeded = ( path == NULL || writeLabels(job, path) ) && storeCentroids(job);
+
+        if( succeeded ) {
+            printMessage(line);
+        }
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        free(parts[p].sums);
+        free(parts[p].counts);
+    }
+
+    return succeeded;
+}
+
+
+bool kmeans( const char * clusters, const char * args ) {
+
+    char * end;
+    long k = strtol(clusters, &end, 10);
+
+    if( *end != '\0' || k < 1 ) {
+        printMessage(ANSI_COLOR_RED "ERROR: The number of clusters must be a positive integer" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    char names[strlen(args) + 1];
+    strcpy(names, args);
+
+    packedVectors points;
+    const char * path = NULL;
+    bool succeeded = false;
+
+    if( packVectors(&points, names, &path) ) {
+
+        if( k > points.count ) {
+            printMessage(ANSI_COLOR_RED "ERROR: More clusters than vectors" ANSI_COLOR_RESET);
+            freePackedVectors(&points);
+            return false;
+        }
+
+        kmeansJob job = {
+            .points = &points,
+            .k = (int) k,
+            .centers = calloc(k, sizeof(*job.centers)),
+            .halfGap = malloc(k * sizeof(double)),
+            .drift = malloc(k * sizeof(double)),
+            .labels = malloc(points.count * sizeof(int)),
+            .upper = malloc(points.count * sizeof(double)),
+            .lower = malloc(points.count * sizeof(double)),
+        };
+
+        if( job.centers == NULL || job.halfGap == NULL || job.drift == NULL ||
+            job.labels == NULL || job.upper == NULL || job.lower == NULL ) {
+            printMessage(ANSI_COLOR_RED "Not enough memory for kmeans" ANSI_COLOR_RESET);
+        } else {
+            succeeded = cluster(&job, path);
+        }
+
+        free(job.centers);
+        free(job.halfGap);
+        free(job.drift);
+        free(job.labels);
+        free(job.upper);
+        free(job.lower);
+    }
+
+    freePackedVectors(&points);
+
+    return succeeded;
+}
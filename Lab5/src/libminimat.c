@@ -0,0 +1,236 @@
+/**
+ * @file libminimat.c
+ * @brief Embeddable C API over the minimat vector library and parser
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ */
+
+#include "libminimat.h"
+#include "mapped.h"
+#include "minimatcmd.h"
+#include <string.h>
+
+// Every entry point works in its workspace through the calling thread's
+// override, so threads with different workspaces never see each other's
+// vectors. Settings, matrices and file-backed vectors (borrowed buffers
+// among them) are process wide.
+
+_Static_assert(MM_MAX_VECTOR_SIZE == MAX_VECTOR_DIMENSION,
+               "mmVectorGet buffers must fit any stored vector");
+
+
+// Indexed by mmOperation
+static const minimatcmdType operationCommands[] = {
+    [MM_ADD]       = ADD,
+    [MM_SUB]       = SUB,
+    [MM_DOTPROD]   = DOTPROD,
+    [MM_XPROD]     = XPROD,
+    [MM_SCALARMUL] = SCALARMUL,
+    [MM_SORT]      = SORT,
+    [MM_ARGSORT]   = ARGSORT,
+    [MM_CUMSUM]    = CUMSUM,
+    [MM_CUMPROD]   = CUMPROD,
+    [MM_SQRT]      = SQRT,
+    [MM_EXP]       = EXP,
+    [MM_LOG]       = LOG,
+    [MM_SIN]       = SIN,
+    [MM_COS]       = COS,
+    [MM_TANH]      = TANH,
+    [MM_ABS]       = ABS,
+};
+
+#define NUM_OPERATIONS ( sizeof(operationCommands) / sizeof(operationCommands[0]) )
+
+
+static bool copyName(char dst[MAX_VECTOR_NAME_LEN], const char * src) {
+
+    if( src == NULL || strlen(src) >= MAX_VECTOR_NAME_LEN ) {
+        return false;
+    }
+
+    strcpy(dst, src);
+
+    return true;
+}
+
+
+int mmVersion( void ) {
+    return LIBMINIMAT_VERSION;
+}
+
+
+mmWorkspace * mmWorkspaceCreate( void ) {
+
+    mmWorkspace * ws = createWorkspace();
+
+    if( ws != NULL ) {
+        ws->quiet = true;
+    }
+
+    return ws;
+}
+
+
+void mmWorkspaceDestroy( mmWorkspace * ws ) {
+    destroyWorkspace(ws);
+}
+
+
+void mmWorkspaceSetOutput( mmWorkspace * ws, FILE * out ) {
+    ws->output = out;
+    ws->quiet = ( out == NULL );
+}
+
+
+bool mmVectorSet( mmWorkspace * ws, const char * name, const double * data, int size ) {
+
+    vector v;
+
+    if( size < 1 || ! copyName(v.vecName, name) ) {
+        return false;
+    }
+
+    workspace * previous = setThreadWorkspace(ws);
+    bool stored;
+
+    // Longer buffers are read where they are like a mapped file, only
+    // ordinary vectors (at most three elements) are copied inline
+    if( size > MAX_VECTOR_DIMENSION ) {
+        stored = borrowVector(v.vecName, data, size);
+    } else {
+        memcpy(v.magnitudes, data, size * sizeof(double));
+        v.vecSize = size;
+
+        unmapVector(v.vecName);
+        stored = addVectorToMemoryList(v);
+    }
+
+    setThreadWorkspace(previous);
+
+    return stored;
+}
+
+
+bool mmVectorGet( mmWorkspace * ws, const char * name, double * data, int * size ) {
+
+    vector v;
+
+    if( ! copyName(v.vecName, name) ) {
+        return false;
+    }
+
+    workspace * previous = setThreadWorkspace(ws);
+    bool found = grabVector(&v);
+    setThreadWorkspace(previous);
+
+    if( ! found ) {
+        return false;
+    }
+
+    memcpy(data, v.magnitudes, v.vecSize * sizeof(double));
+    *size = v.vecSize;
+
+    return true;
+}
+
+
+bool mmApply( mmWorkspace * ws, mmOperation op, const char * dst,
+              const char * a, const char * b, double scalar ) {
+
+    if( (unsigned) op >= NUM_OPERATIONS ) {
+        return false;
+    }
+
+    minimatcmd cmd = {0};
+    cmd.operation = operationCommands[op];
+    cmd.scalar = scalar;
+
+    char name[MAX_VECTOR_NAME_LEN];
+
+    // b is only read by the binary operations
+    if( ! copyName(cmd.operands[0].vecName, a) ||
+        ! copyName(cmd.operands[1].vecName, ( b != NULL ) ? b : "") ||
+        ! copyName(name, dst) ) {
+        return false;
+    }
+
+    workspace * previous = setThreadWorkspace(ws);
+
+    vector result;
+    bool stored = false;
+
+    // Borrowed and mapped operands stream like they do in the REPL
+    if( involvesMappedVectors(cmd) ) {
+        mappedTask * task = prepareMappedCmd(cmd, name);
+
+        if( task != NULL ) {
+            runMappedTask(task);
+            stored = finishMappedTask(task);
+        }
+
+    } else if( minimatEvaluateCmd(cmd, &result) && ! FAILED_RESULT(result) ) {
+        strcpy(result.vecName, name);
+        unmapVector(result.vecName);
+        stored = addVectorToMemoryList(result);
+    }
+
+    setThreadWorkspace(previous);
+
+    return stored;
+}
+
+
+int mmExecute( mmWorkspace * ws, const char * commands ) {
+
+    int failures = 0;
+
+    workspace * previous = setThreadWorkspace(ws);
+
+    while( *commands != '\0' ) {
+
+        size_t len = strcspn(commands, "\n;");
+        char inputBuffer[INPUT_BUFFER_SIZE];
+
+        // Trim surrounding spaces so the parser sees the same thing as the REPL
+        const char * line = commands;
+        size_t lineLen = len;
+
+        while( lineLen > 0 && *line == ' ' ) {
+            ++line;
+            --lineLen;
+        }
+
+        while( lineLen > 0 && line[lineLen - 1] == ' ' ) {
+            --lineLen;
+        }
+
+        commands += len + ( commands[len] != '\0' );
+
+        if( lineLen == 0 ) {
+            continue;
+        }
+
+        if( lineLen >= sizeof(inputBuffer) ) {
+            ++failures;
+            continue;
+        }
+
+        memcpy(inputBuffer, line, lineLen);
+        inputBuffer[lineLen] = '\0';
+
+        if( strcmp(inputBuffer, EXIT_SYMBOL) == 0 ) {
+            break;
+        }
+
+        if( ! minimatExecuteCmd(minimatProcessCmd(inputBuffer)) ) {
+            ++failures;
+        }
+    }
+
+    setThreadWorkspace(previous);
+
+    return failures;
+}
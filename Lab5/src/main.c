@@ -0,0 +1,47 @@
+/**
+ * @file main.c
+ * @brief Entry point of the interactive minimat calculator
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Usage: minimat [-j threads]
+ *  - With no arguments commands are run one at a time as they are typed
+ *  - With -j the script on stdin is run in batches, independent
+ *    statements in parallel on that many threads
+ */
+
+#include "minimatcmd.h"
+#include "batch.h"
+#include "termcolors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int main ( int argc, char * argv[] ) {
+
+    if( argc == 3 && strcmp(argv[1], "-j") == 0 ) {
+        int threads = atoi(argv[2]);
+
+        if( threads < 1 || threads > MAX_BATCH_THREADS ) {
+            fprintf(stderr, "minimat: thread count must be 1 to %d\n", MAX_BATCH_THREADS);
+            return 1;
+        }
+
+        runBatch(stdin, threads);
+
+    } else if( argc != 1 ) {
+        fprintf(stderr, "usage: %s [-j threads]\n", argv[0]);
+        return 1;
+
+    } else {
+        while ( minimatExecutionLoop() ) { /* Nothing here */ }
+    }
+    
+    puts(ANSI_COLOR_CYAN "Exiting..." ANSI_COLOR_RESET);
+
+    return 0;
+}
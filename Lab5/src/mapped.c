@@ -0,0 +1,1811 @@
+/**
+ * @file mapped.c
+ * @brief File-backed and generated vectors of any length, streamed
+ * through in chunks
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - A mapped vector is a name bound to a file of raw native doubles
+ *  - Operations walk the operands one MAPPED_CHUNK_BYTES window at a time
+ *    - Each window is mmap'd, hinted sequential, and the next one read ahead
+ *    - Element-wise results go to a file-backed ans, reductions to memory
+ *    - add, sub, the scalings and dot run kernels.c's unrolled kernels,
+ *      KERNEL_MAX_SIZE elements per call
+ *    - sqrt, exp and the other functions call libm on every element, the
+ *      same as the in-memory versions, so both give identical results.
+ *      With "fastmath on" they run fastmath.c's vectorized versions
+ *      instead, within the ULP bounds in fastmath.h
+ *    - Masks, where, select and compress stream like any element-wise
+ *      op, numbers and short in-memory operands are held in the task.
+ *      compress appends what it keeps, so its result may be shorter
+ *    - A gather maps its whole source for random reads and streams the
+ *      indices, prefetching the elements a block of them will load
+ *    - Results short enough to be ordinary vectors are stored as one
+ *    - rand, randn and randi of more elements than an ordinary vector
+ *      holds fill the result a window at a time (random.c)
+ *    - cumsum and cumprod copy each window into the result and scan it
+ *      in place (scan.c), carrying the running total to the next window
+ *  - sort and argsort are LSD radix sorts (radix.c). A counting pass
+ *    finds the digits that differ, then each of those is one pass from
+ *    the input to a scratch file, the last pass writing the result
+ *  - Windows are unmapped as soon as they are processed
+ *  - In-place updates ("x += y") map the result window over x's own file
+ *    when minimat wrote it. A file the user mapped is never written, the
+ *    first update goes to a copy in the result directory which x then
+ *    names (copy on write)
+ *  - "b = x" streams a copy of x into the result directory. A cross
+ *    product reads its three elements of each operand directly
+ *  - A generator (range, linspace, zeros, ones) is a mapped vector with
+ *    no file. Its elements are computed GENERATED_BLOCK at a time as the
+ *    windows go by, until "materialize" writes them out
+ *  - A borrowed vector is a libminimat caller's buffer, read where it is
+ *    the same way as a window. It is never written, updates in place
+ *    copy it into the result directory like a user's file
+ *  - With "compress on", file-backed vectors left unused for
+ *    COLD_AFTER_COMMANDS commands are rewritten Gorilla compressed
+ *    (compress.c) and decoded a block at a time whenever they are read
+ *    - Once the copy is verified, the raw file of a result minimat wrote
+ *      is deleted. A file the user mapped is kept
+ *  - Results and compressed copies live in a private mkdtemp directory,
+ *    deleted as their names are replaced and removed on clear and exit
+ */
+
+#include "mapped.h"
+#include "termcolors.h"
+#include "compress.h"
+#include "fastmath.h"
+#include "kernels.h"
+#include "random.h"
+#include "radix.h"
+#include "scan.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_PATH_LEN INPUT_BUFFER_SIZE
+// Elements of a generated operand are computed this many at a time
+#define GENERATED_BLOCK 512
+// where takes a mask and two values
+#define MAX_STREAM_OPERANDS 3
+// Gathered elements are prefetched this far ahead of the one loaded
+#define GATHER_PREFETCH_DISTANCE 16
+// A gather result that would overwrite its own source goes here instead
+#define ALTERNATE_RESULT_SUFFIX ".alt" MAPPED_RESULT_SUFFIX
+// Sort passes go back and forth between these two files
+#define SORT_SCRATCH_SUFFIX_A ".pass0.tmp"
+#define SORT_SCRATCH_SUFFIX_B ".pass1.tmp"
+
+typedef struct {
+
+    char vecName[MAX_VECTOR_NAME_LEN];
+    char path[MAX_PATH_LEN];
+    size_t length; // number of doubles in the file
+    bool owned; // minimat wrote the file, it goes when the name does
+
+    // Generators have no file, element i is start + i * step except the
+    // last which is exactly last (so linspace ends on its stop)
+    bool generated;
+    double start;
+    double step;
+    double last;
+
+    // Short in-memory operands copied into a task, never in the table
+    bool inMemory;
+    double values[MAX_VECTOR_DIMENSION];
+
+    // The caller's buffer, which must outlive the name
+    const double * borrowed;
+
+    // Cold vectors are read from a compressed copy instead of the file
+    bool compressed;
+    bool incompressible; // tried already, the copy was no smaller
+    char packedPath[MAX_PATH_LEN];
+    size_t packedBytes;
+    uint64_t lastUsed; // command count when last read or written
+    size_t decodedValues;
+    double decodeSeconds;
+
+} mappedVector;
+
+typedef enum {
+
+    STREAM_ADD,
+    STREAM_SUB,
+    STREAM_SCALE,
+    STREAM_AXPY,
+    STREAM_DOT,
+    STREAM_COPY,
+    STREAM_APPLY,
+    STREAM_GREATER,
+    STREAM_LESS,
+    STREAM_WHERE, // mask, a, b
+    STREAM_COMPRESS, // mask, a
+    STREAM_GATHER, // source, indices
+    STREAM_RANDOM, // no operands
+    STREAM_CUMSUM,
+    STREAM_CUMPROD,
+    STREAM_SORT, // not streamed, sortTask runs the radix passes
+    STREAM_ARGSORT,
+    STREAM_XPROD // not streamed, three elements each
+
+} streamOp;
+
+typedef double (*elementFn)(double);
+
+static mappedVector mappedVectors[MAX_MAPPED_VECTORS];
+static int numMapped = 0;
+static bool compressCold = false;
+static bool fastMath = false;
+static uint64_t commandCount = 0;
+// Where results and compressed copies are written, empty until needed
+static char resultDir[MAX_PATH_LEN];
+
+
+/**
+ * Deletes everything in the result directory and the directory itself
+ */
+static void removeResultDir(void) {
+
+    DIR * dir = ( resultDir[0] != '\0' ) ? opendir(resultDir) : NULL;
+
+    if( dir == NULL ) {
+        return;
+    }
+
+    char path[MAX_PATH_LEN];
+    struct dirent * entry;
+
+    while( ( entry = readdir(dir) ) != NULL ) {
+        if( strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0 &&
+            snprintf(path, sizeof(path), "%s/%s", resultDir, entry->d_name) < (int) sizeof(path) ) {
+            unlink(path);
+        }
+    }
+
+    closedir(dir);
+    rmdir(resultDir);
+    resultDir[0] = '\0';
+}
+
+
+/**
+ * Path of the file minimat keeps for name, creating the private result
+ * directory the first time one is needed
+ */
+static bool resultPath(const char * name, const char * suffix, char * path) {
+
+    static bool cleanupRegistered = false;
+
+    if( resultDir[0] == '\0' ) {
+        const char * tmp = getenv("TMPDIR");
+
+        snprintf(resultDir, sizeof(resultDir), "%s/minimat-XXXXXX",
+                 ( tmp != NULL && tmp[0] != '\0' ) ? tmp : "/tmp");
+
+        if( mkdtemp(resultDir) == NULL ) {
+            resultDir[0] = '\0';
+            printMessage(ANSI_COLOR_RED "Could not create a directory for mapped results!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        if( ! cleanupRegistered ) {
+            atexit(removeResultDir);
+            cleanupRegistered = true;
+        }
+    }
+
+    if( snprintf(path, MAX_PATH_LEN, "%s/%s%s", resultDir, name, suffix) >= MAX_PATH_LEN ) {
+        printMessage(ANSI_COLOR_RED "File path is too long!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Deletes the files minimat made for v, a file the user mapped is left
+ * alone. keepPath is about to be reused and is kept too
+ */
+static void releaseFiles(const mappedVector * v, const char * keepPath) {
+
+    if( v->owned && ( keepPath == NULL || strcmp(v->path, keepPath) != 0 ) ) {
+        unlink(v->path);
+    }
+
+    if( v->compressed ) {
+        unlink(v->packedPath);
+    }
+}
+
+
+static mappedVector * findMapped(const char * name) {
+
+    for(int i = 0; i < numMapped; ++i) {
+        if( strcmp(mappedVectors[i].vecName, name) == 0 ) {
+            return &mappedVectors[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+bool isMappedVector( const char * name ) {
+    return findMapped(name) != NULL;
+}
+
+
+bool anyMappedVectors( void ) {
+    return numMapped > 0;
+}
+
+
+void unmapVector( const char * name ) {
+
+    mappedVector * found = findMapped(name);
+
+    if( found != NULL ) {
+        releaseFiles(found, NULL);
+        *found = mappedVectors[--numMapped];
+    }
+}
+
+
+void unmapVectors( void ) {
+    numMapped = 0;
+    removeResultDir();
+}
+
+
+static mappedVector * claimSlot(const char * name, const char * path) {
+
+    mappedVector * slot = findMapped(name);
+
+    if( slot != NULL ) {
+        releaseFiles(slot, path);
+    } else {
+
+        if( numMapped >= MAX_MAPPED_VECTORS ) {
+            printMessage(ANSI_COLOR_RED "Mapped vector table is full!" ANSI_COLOR_RESET);
+            return NULL;
+        }
+
+        slot = &mappedVectors[numMapped++];
+    }
+
+    // The name now means this vector, not an in-memory one
+    removeVector(name);
+
+    memset(slot, 0, sizeof(*slot));
+    strcpy(slot->vecName, name);
+    slot->lastUsed = commandCount;
+
+    return slot;
+}
+
+
+static void printMapped(const mappedVector * v) {
+
+    char line[MAX_VECTOR_NAME_LEN + MAX_PATH_LEN + 64];
+
+    if( v->generated ) {
+        snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s = [%zu elements, generated]" ANSI_COLOR_RESET,
+                 v->vecName, v->length);
+    } else if( v->borrowed != NULL ) {
+        snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s = [%zu elements, borrowed]" ANSI_COLOR_RESET,
+                 v->vecName, v->length);
+    } else {
+        snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s = [%zu elements in %s]" ANSI_COLOR_RESET,
+                 v->vecName, v->length, v->path);
+    }
+
+    printMessage(line);
+}
+
+
+static bool bindFile(const char * name, const char * path, bool owned) {
+
+    struct stat info;
+
+    if( stat(path, &info) != 0 || info.st_size % sizeof(double) != 0 ) {
+        printMessage(ANSI_COLOR_RED "File is not a vector of doubles!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    if( strlen(path) >= MAX_PATH_LEN ) {
+        printMessage(ANSI_COLOR_RED "File path is too long!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    mappedVector * slot = claimSlot(name, path);
+
+    if( slot == NULL ) {
+        return false;
+    }
+
+    strcpy(slot->path, path);
+    slot->length = info.st_size / sizeof(double);
+    slot->owned = owned;
+
+    return true;
+}
+
+
+bool mapVectorFile( const char * name, const char * path ) {
+    return bindFile(name, path, false);
+}
+
+
+bool borrowVector( const char * name, const double * data, size_t length ) {
+
+    if( data == NULL || length == 0 ) {
+        return false;
+    }
+
+    mappedVector * slot = claimSlot(name, NULL);
+
+    if( slot == NULL ) {
+        return false;
+    }
+
+    slot->borrowed = data;
+    slot->length = length;
+
+    return true;
+}
+
+
+/**
+ * Works out the element count for a generator, or 0 if it is invalid
+ */
+static double generatorLength(const char * kind, const double * args, int numArgs,
+                              double * start, double * step) {
+
+    if( strcmp(kind, RANGE_KEYWORD) == 0 && numArgs >= 1 ) {
+        // range stop, range start stop, range start stop step
+        double from = ( numArgs >= 2 ) ? args[0] : 0.0;
+        double to = ( numArgs >= 2 ) ? args[1] : args[0];
+        double by = ( numArgs == 3 ) ? args[2] : 1.0;
+
+        *start = from;
+        *step = by;
+
+        return ( by == 0.0 ) ? 0.0 : ceil(( to - from ) / by);
+    }
+
+    if( strcmp(kind, LINSPACE_KEYWORD) == 0 && numArgs == 3 ) {
+        *start = args[0];
+        *step = ( args[2] > 1 ) ? ( args[1] - args[0] ) / ( args[2] - 1 ) : 0.0;
+
+        return args[2];
+    }
+
+    if( ( strcmp(kind, ZEROS_KEYWORD) == 0 || strcmp(kind, ONES_KEYWORD) == 0 ) && numArgs == 1 ) {
+        *start = ( strcmp(kind, ONES_KEYWORD) == 0 ) ? 1.0 : 0.0;
+        *step = 0.0;
+
+        return args[0];
+    }
+
+    return 0.0;
+}
+
+
+bool defineGenerator( const char * name, const char * kind, const double * args, int numArgs ) {
+
+    double start;
+    double step;
+    double length = generatorLength(kind, args, numArgs, &start, &step);
+
+    // Lengths beyond what a file of doubles could hold are refused too
+    if( ! ( length >= 1 ) || length != floor(length) || length > (double) ( SIZE_MAX / sizeof(double) ) ) {
+        printMessage(ANSI_COLOR_RED "ERROR: That generator has no elements or too many" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    mappedVector * slot = claimSlot(name, NULL);
+
+    if( slot == NULL ) {
+        return false;
+    }
+
+    slot->generated = true;
+    slot->length = (size_t) length;
+    slot->start = start;
+    slot->step = step;
+    slot->last = ( strcmp(kind, LINSPACE_KEYWORD) == 0 ) ? args[1] : start + ( slot->length - 1 ) * step;
+
+    printMapped(slot);
+
+    return true;
+}
+
+
+static double generatedElement(const mappedVector * v, size_t i) {
+    return ( i == v->length - 1 ) ? v->last : v->start + i * v->step;
+}
+
+
+static double secondsBetween(const struct timespec * start, const struct timespec * end) {
+    return ( end->tv_sec - start->tv_sec ) + ( end->tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+
+/**
+ * Elements [first, first + count) of an operand, straight from its window
+ * or computed into scratch for a generator or compressed vector
+ */
+static const double * operandElements(mappedVector * v, gorillaDecoder * decoder, const double * window,
+                                      size_t windowFirst, size_t first, size_t count, double * scratch) {
+
+    if( v->compressed ) {
+        struct timespec start;
+        struct timespec end;
+
+        // Operands are always read front to back, so the stream stays in step
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        decodeValues(decoder, scratch, count);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        v->decodedValues += count;
+        v->decodeSeconds += secondsBetween(&start, &end);
+
+        return scratch;
+    }
+
+    if( v->inMemory ) {
+        return v->values + first;
+    }
+
+    if( v->borrowed != NULL ) {
+        return v->borrowed + first;
+    }
+
+    if( ! v->generated ) {
+        return window + ( first - windowFirst );
+    }
+
+    for(size_t i = 0; i < count; ++i) {
+        scratch[i] = generatedElement(v, first + i);
+    }
+
+    return scratch;
+}
+
+
+/**
+ * The function an element-wise command applies, NULL for any other
+ */
+static elementFn elementFunction(minimatcmdType operation) {
+
+    switch(operation) {
+        case SQRT: return sqrt;
+        case EXP:  return exp;
+        case LOG:  return log;
+        case SIN:  return sin;
+        case COS:  return cos;
+        case TANH: return tanh;
+        case ABS:  return fabs;
+        default:   return NULL;
+    }
+}
+
+
+/**
+ * fastmath.c's version of the same, NULL while "fastmath off"
+ */
+static arrayFn fastFunction(minimatcmdType operation) {
+
+    if( ! fastMath ) {
+        return NULL;
+    }
+
+    switch(operation) {
+        case SQRT: return fastSqrt;
+        case EXP:  return fastExp;
+        case LOG:  return fastLog;
+        case SIN:  return fastSin;
+        case COS:  return fastCos;
+        case TANH: return fastTanh;
+        case ABS:  return fastAbs;
+        default:   return NULL;
+    }
+}
+
+
+bool involvesMappedVectors( minimatcmd cmd ) {
+
+    if( elementFunction(cmd.operation) != NULL ) {
+        return isMappedVector(cmd.operands[0].vecName);
+    }
+
+    switch(cmd.operation) {
+
+        // Too many for an ordinary vector, a NaN count is refused there
+        case RAND:
+        case RANDN:
+            return cmd.operands[0].magnitudes[0] > MAX_VECTOR_DIMENSION;
+
+        case RANDI:
+            return cmd.operands[0].magnitudes[2] > MAX_VECTOR_DIMENSION;
+
+        // A copy reads operands[1] into the name in operands[0]
+        case DATA_COPY:
+            return isMappedVector(cmd.operands[1].vecName);
+
+        case ADD:
+        case SUB:
+        case DOTPROD:
+        case XPROD:
+            return isMappedVector(cmd.operands[0].vecName) ||
+                   isMappedVector(cmd.operands[1].vecName);
+
+        case ADD_ASSIGN:
+        case SUB_ASSIGN:
+        case AXPY:
+            return isMappedVector(cmd.operands[0].vecName) ||
+                   isMappedVector(cmd.operands[1].vecName);
+
+        case SCALARMUL:
+        case SCALE_ASSIGN:
+        case SORT:
+        case ARGSORT:
+        case CUMSUM:
+        case CUMPROD:
+            return isMappedVector(cmd.operands[0].vecName);
+
+        case GREATER:
+        case LESS:
+        case GATHER:
+            return isMappedVector(cmd.operands[0].vecName) ||
+                   isMappedVector(cmd.operands[1].vecName);
+
+        case WHERE:
+            return isMappedVector(cmd.arguments) || isMappedVector(cmd.operands[0].vecName) ||
+                   isMappedVector(cmd.operands[1].vecName);
+
+        case SELECT:
+        case COMPRESS_MASKED:
+            return isMappedVector(cmd.arguments) || isMappedVector(cmd.operands[0].vecName);
+
+        default:
+            return false;
+    }
+}
+
+
+static double * mapWindow(int fd, size_t offset, size_t bytes, int prot) {
+
+    void * window = mmap(NULL, bytes, prot, MAP_SHARED, fd, offset);
+
+    if( window == MAP_FAILED ) {
+        return NULL;
+    }
+
+    madvise(window, bytes, MADV_SEQUENTIAL);
+
+    // Start reading the following window while this one is processed
+    posix_fadvise(fd, offset + bytes, MAPPED_CHUNK_BYTES, POSIX_FADV_WILLNEED);
+
+    return window;
+}
+
+
+static bool readsFile(const mappedVector * v) {
+    return v != NULL && ! v->generated && ! v->compressed && ! v->inMemory && v->borrowed == NULL;
+}
+
+
+struct mappedTask {
+
+    // Copies, the table may change while the task streams. A gather's
+    // source comes first and is read at random, the indices drive the stream
+    mappedVector operands[MAX_STREAM_OPERANDS];
+    int numOperands;
+    size_t length; // elements streamed
+    streamOp op;
+    double scalar;
+    elementFn fn; // applied to each element by STREAM_APPLY
+    arrayFn fast; // or to each block, with "fastmath on"
+    randomRun random; // filled in by STREAM_RANDOM
+    bool inPlace;
+    char resultName[MAX_VECTOR_NAME_LEN];
+    char resultPath[MAX_PATH_LEN]; // empty when the result is a reduction
+    char scratchPaths[2][MAX_PATH_LEN]; // sort passes only
+    size_t resultLength; // fewer than length once compressed
+    double dot;
+    const char * error; // why the operands were refused, NULL for I/O
+    bool ok;
+
+};
+
+
+/**
+ * Maps all of a gather's source for random reads. A borrowed buffer is
+ * read as it is, generators and in-memory vectors without one give NULL
+ */
+static const double * mapSource(const mappedVector * v, int * fd) {
+
+    *fd = -1;
+
+    if( v->borrowed != NULL ) {
+        return v->borrowed;
+    }
+
+    if( v->generated || v->inMemory ) {
+        return NULL;
+    }
+
+    // A compressed user file still has its raw file, it is read directly
+    *fd = open(v->path, O_RDONLY);
+
+    if( *fd < 0 ) {
+        return MAP_FAILED;
+    }
+
+    void * source = mmap(NULL, v->length * sizeof(double), PROT_READ, MAP_SHARED, *fd, 0);
+
+    if( source != MAP_FAILED ) {
+        madvise(source, v->length * sizeof(double), MADV_RANDOM);
+    }
+
+    return source;
+}
+
+
+/**
+ * Gathers count elements of source at one-based indices. Loads from the
+ * file are prefetched GATHER_PREFETCH_DISTANCE elements ahead
+ */
+static bool gatherBlock(const mappedVector * source, const double * file, const double * indices,
+                        double * out, size_t count) {
+
+    size_t positions[GENERATED_BLOCK];
+
+    for(size_t i = 0; i < count; ++i) {
+        // Range checked as a double, converting one out of range is undefined
+        if( ! ( indices[i] >= 1 && indices[i] <= (double) source->length ) ||
+            indices[i] != floor(indices[i]) ) {
+            return false;
+        }
+
+        positions[i] = (size_t) indices[i] - 1;
+    }
+
+    for(size_t i = 0; i < count; ++i) {
+        if( file == NULL ) {
+            out[i] = source->generated ? generatedElement(source, positions[i]) : source->values[positions[i]];
+            continue;
+        }
+
+        if( i + GATHER_PREFETCH_DISTANCE < count ) {
+            __builtin_prefetch(&file[positions[i + GATHER_PREFETCH_DISTANCE]]);
+        }
+
+        out[i] = file[positions[i]];
+    }
+
+    return true;
+}
+
+
+/**
+ * Streams the task's operands through its operation, writing the result
+ * file or summing into task->dot
+ */
+static bool streamTask(mappedTask * task) {
+
+    mappedVector * ops = task->operands;
+    bool gathering = ( task->op == STREAM_GATHER );
+    bool compressing = ( task->op == STREAM_COMPRESS );
+    bool scanning = ( task->op == STREAM_CUMSUM || task->op == STREAM_CUMPROD );
+    int firstStreamed = gathering ? 1 : 0;
+
+    gorillaDecoder decoders[MAX_STREAM_OPERANDS];
+    int fds[MAX_STREAM_OPERANDS];
+    bool ok = true;
+
+    for(int i = 0; i < MAX_STREAM_OPERANDS; ++i) {
+        decoders[i].in = NULL;
+        fds[i] = -1;
+    }
+
+    for(int i = firstStreamed; ok && i < task->numOperands; ++i) {
+        if( readsFile(&ops[i]) ) {
+            fds[i] = open(ops[i].path, O_RDONLY);
+            ok = ( fds[i] >= 0 );
+        } else if( ops[i].compressed ) {
+            ok = openDecoder(&decoders[i], ops[i].packedPath);
+        }
+    }
+
+    int fdSource = -1;
+    const double * source = ( ok && gathering ) ? mapSource(&ops[0], &fdSource) : NULL;
+    ok = ok && source != MAP_FAILED;
+
+    const char * resultPath = ( task->resultPath[0] != '\0' ) ? task->resultPath : NULL;
+    int fdOut = ( ok && resultPath != NULL ) ? open(resultPath, O_RDWR | O_CREAT, 0644) : -1;
+    size_t totalBytes = task->length * sizeof(double);
+    ok = ok && ( resultPath == NULL || fdOut >= 0 );
+
+    // Not truncated first, the result may be one of the operands
+    if( ok && fdOut >= 0 ) {
+        ok = ftruncate(fdOut, totalBytes) == 0;
+    }
+
+    double total = 0.0;
+    double carry = ( task->op == STREAM_CUMPROD ) ? 1.0 : 0.0;
+    size_t kept = 0;
+    double scratch[MAX_STREAM_OPERANDS][GENERATED_BLOCK];
+    double packed[GENERATED_BLOCK];
+
+    for(size_t offset = 0; ok && offset < totalBytes; offset += MAPPED_CHUNK_BYTES) {
+
+        size_t bytes = totalBytes - offset;
+        if( bytes > MAPPED_CHUNK_BYTES ) {
+            bytes = MAPPED_CHUNK_BYTES;
+        }
+
+        size_t windowFirst = offset / sizeof(double);
+        size_t windowCount = bytes / sizeof(double);
+        double * windows[MAX_STREAM_OPERANDS] = { NULL };
+
+        for(int i = firstStreamed; i < task->numOperands; ++i) {
+            if( fds[i] >= 0 ) {
+                windows[i] = mapWindow(fds[i], offset, bytes, PROT_READ);
+                ok = ok && windows[i] != NULL;
+            }
+        }
+
+        // Compressed results are appended instead, they fall behind the input
+        double * out = ( fdOut >= 0 && ! compressing ) ? mapWindow(fdOut, offset, bytes, PROT_READ | PROT_WRITE) : NULL;
+        ok = ok && ( fdOut < 0 || compressing || out != NULL );
+
+        for(size_t block = 0; ok && block < windowCount; block += GENERATED_BLOCK) {
+
+            size_t count = windowCount - block;
+            if( count > GENERATED_BLOCK ) {
+                count = GENERATED_BLOCK;
+            }
+
+            size_t first = windowFirst + block;
+            const double * in[MAX_STREAM_OPERANDS] = { NULL };
+
+            for(int i = firstStreamed; i < task->numOperands; ++i) {
+                in[i] = operandElements(&ops[i], &decoders[i], windows[i], windowFirst, first, count, scratch[i]);
+            }
+
+            const double * xs = in[0];
+            const double * ys = in[1];
+            const double * zs = in[2];
+            double * os = ( out != NULL ) ? out + block : NULL;
+            size_t packedCount = 0;
+
+            switch(task->op) {
+                // The arithmetic runs the unrolled kernels (kernels.c)
+                case STREAM_ADD:
+                    runKernels(addKernels, xs, ys, os, count);
+                    break;
+
+                case STREAM_SUB:
+                    runKernels(subKernels, xs, ys, os, count);
+                    break;
+
+                case STREAM_SCALE:
+                    runKernels(scaleKernels, xs, &task->scalar, os, count);
+                    break;
+
+                // In place os is x's own window already, otherwise x is
+                // copied to the result to be added to
+                case STREAM_AXPY:
+                    if( ! task->inPlace ) {
+                        memcpy(os, xs, count * sizeof(double));
+                    }
+
+                    runKernels(axpyKernels, ys, &task->scalar, os, count);
+                    break;
+
+                case STREAM_DOT:
+                    total += runReduction(dotKernels, xs, ys, count);
+                    break;
+
+                // Scans copy the window first, then scan it in place below
+                case STREAM_COPY:
+                case STREAM_CUMSUM:
+                case STREAM_CUMPROD:
+                    memcpy(os, xs, count * sizeof(double));
+                    break;
+
+                case STREAM_APPLY:
+                    if( task->fast != NULL ) {
+                        task->fast(xs, os, count);
+                    } else {
+                        for(size_t i = 0; i < count; ++i) os[i] = task->fn(xs[i]);
+                    }
+                    break;
+
+                // Masks hold 1 where the relation holds and 0 elsewhere
+                case STREAM_GREATER:
+                    for(size_t i = 0; i < count; ++i) os[i] = xs[i] > ys[i];
+                    break;
+
+                case STREAM_LESS:
+                    for(size_t i = 0; i < count; ++i) os[i] = xs[i] < ys[i];
+                    break;
+
+                case STREAM_WHERE:
+                    for(size_t i = 0; i < count; ++i) os[i] = ( xs[i] != 0 ) ? ys[i] : zs[i];
+                    break;
+
+                // Store every element, advance only past the kept ones
+                case STREAM_COMPRESS:
+                    for(size_t i = 0; i < count; ++i) {
+                        packed[packedCount] = ys[i];
+                        packedCount += ( xs[i] != 0 );
+                    }
+
+                    ok = pwrite(fdOut, packed, packedCount * sizeof(double), kept * sizeof(double)) ==
+                         (ssize_t) ( packedCount * sizeof(double) );
+                    kept += packedCount;
+                    break;
+
+                case STREAM_GATHER:
+                    if( ! gatherBlock(&ops[0], source, ys, os, count) ) {
+                        task->error = "Index out of range!";
+                        ok = false;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        if( ok && scanning ) {
+            scanWindow(out, windowCount, &carry, task->op == STREAM_CUMPROD);
+        }
+
+        // Filled a whole window at once, which random.c splits across threads
+        if( ok && task->op == STREAM_RANDOM ) {
+            fillRandomRun(&task->random, windowFirst, out, windowCount);
+        }
+
+        for(int i = 0; i < MAX_STREAM_OPERANDS; ++i) {
+            if( windows[i] != NULL ) munmap(windows[i], bytes);
+        }
+
+        if( out != NULL ) munmap(out, bytes);
+    }
+
+    if( ok && compressing && kept == 0 ) {
+        task->error = "The mask selects no elements!";
+        ok = false;
+    }
+
+    if( ok && compressing ) {
+        ok = ftruncate(fdOut, kept * sizeof(double)) == 0;
+    }
+
+    for(int i = 0; i < MAX_STREAM_OPERANDS; ++i) {
+        if( fds[i] >= 0 ) close(fds[i]);
+        closeDecoder(&decoders[i]);
+    }
+
+    if( fdSource >= 0 && source != MAP_FAILED ) munmap((void *) source, ops[0].length * sizeof(double));
+    if( fdSource >= 0 ) close(fdSource);
+    if( fdOut >= 0 ) close(fdOut);
+
+    task->resultLength = compressing ? kept : task->length;
+    task->dot = total;
+
+    return ok;
+}
+
+
+/**
+ * Runs radixCount (pass NULL) or radixScatter over a file of source
+ * doubles or of the records an earlier pass wrote, one window at a time
+ */
+static bool radixFile(const char * path, size_t length, bool records, uint64_t (*counts)[RADIX_BUCKETS],
+                      radixPass * pass) {
+
+    size_t elementBytes = ( records && pass->indexed ) ? 2 * sizeof(uint64_t) : sizeof(double);
+
+    int fd = open(path, O_RDONLY);
+    size_t totalBytes = length * elementBytes;
+    bool ok = ( fd >= 0 );
+
+    for(size_t offset = 0; ok && offset < totalBytes; offset += MAPPED_CHUNK_BYTES) {
+
+        size_t bytes = totalBytes - offset;
+        if( bytes > MAPPED_CHUNK_BYTES ) {
+            bytes = MAPPED_CHUNK_BYTES;
+        }
+
+        double * window = mapWindow(fd, offset, bytes, PROT_READ);
+
+        if( window == NULL ) {
+            ok = false;
+            break;
+        }
+
+        radixWindow w = {
+            .values = records ? NULL : window,
+            .records = (const uint64_t *) window,
+            .first = offset / elementBytes,
+            .count = bytes / elementBytes,
+        };
+
+        ok = ( pass == NULL ) ? radixCount(&w, counts) : radixScatter(&w, pass);
+        munmap(window, bytes);
+    }
+
+    if( fd >= 0 ) {
+        close(fd);
+    }
+
+    return ok;
+}
+
+
+/**
+ * Sorts the task's operand into its result, one radix pass per digit on
+ * which the elements differ
+ */
+static bool sortTask(mappedTask * task) {
+
+    mappedVector * v = &task->operands[0];
+    const char * source = v->path;
+    bool indexed = ( task->op == STREAM_ARGSORT );
+    bool ok = true;
+
+    // Generated, compressed and borrowed operands are written out raw to
+    // be read by the passes, the second scratch file is free until pass two
+    if( ! readsFile(v) ) {
+        mappedTask copy = { .operands = { *v }, .numOperands = 1, .length = v->length, .op = STREAM_COPY };
+        strcpy(copy.resultPath, task->scratchPaths[1]);
+
+        ok = streamTask(&copy);
+        v->decodedValues = copy.operands[0].decodedValues;
+        v->decodeSeconds = copy.operands[0].decodeSeconds;
+        source = task->scratchPaths[1];
+    }
+
+    uint64_t (*counts)[RADIX_BUCKETS] = calloc(RADIX_PASSES, sizeof(*counts));
+    radixPass * pass = malloc(sizeof(radixPass));
+
+    ok = ok && counts != NULL && pass != NULL && radixFile(source, task->length, false, counts, NULL);
+
+    // A digit every element shares leaves the order as it is
+    int digits[RADIX_PASSES];
+    int numDigits = 0;
+
+    for(int d = 0; ok && d < RADIX_PASSES; ++d) {
+        bool shared = false;
+
+        for(int b = 0; b < RADIX_BUCKETS && ! shared; ++b) {
+            shared = ( counts[d][b] == task->length );
+        }
+
+        if( ! shared ) {
+            digits[numDigits++] = d;
+        }
+    }
+
+    // All equal, one pass still writes the result
+    if( numDigits == 0 ) {
+        digits[numDigits++] = 0;
+    }
+
+    const char * input = source;
+
+    for(int p = 0; ok && p < numDigits; ++p) {
+
+        const char * output = ( p == numDigits - 1 ) ? task->resultPath : task->scratchPaths[p % 2];
+        uint64_t position = 0;
+
+        pass->digit = digits[p];
+        pass->indexed = indexed;
+        pass->last = ( p == numDigits - 1 );
+
+        for(int b = 0; b < RADIX_BUCKETS; ++b) {
+            pass->next[b] = position;
+            position += counts[pass->digit][b];
+        }
+
+        size_t outBytes = ( pass->last || ! indexed ) ? sizeof(double) : 2 * sizeof(uint64_t);
+
+        pass->fdOut = open(output, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ok = pass->fdOut >= 0 && ftruncate(pass->fdOut, task->length * outBytes) == 0 &&
+             radixFile(input, task->length, p > 0, NULL, pass);
+
+        if( pass->fdOut >= 0 ) {
+            close(pass->fdOut);
+        }
+
+        input = output;
+    }
+
+    unlink(task->scratchPaths[0]);
+    unlink(task->scratchPaths[1]);
+    free(counts);
+    free(pass);
+
+    task->resultLength = task->length;
+
+    return ok;
+}
+
+
+/**
+ * Reads all of an operand at most MAX_VECTOR_DIMENSION long
+ */
+static bool readShort(mappedVector * v, double * out) {
+
+    if( v->inMemory || v->borrowed != NULL ) {
+        memcpy(out, v->inMemory ? v->values : v->borrowed, v->length * sizeof(double));
+        return true;
+    }
+
+    if( v->generated ) {
+        for(size_t i = 0; i < v->length; ++i) {
+            out[i] = generatedElement(v, i);
+        }
+
+        return true;
+    }
+
+    if( v->compressed ) {
+        gorillaDecoder decoder = { .in = NULL };
+        bool ok = openDecoder(&decoder, v->packedPath);
+
+        // Decoded into out itself, so decode time is counted as usual
+        if( ok ) {
+            operandElements(v, &decoder, NULL, 0, 0, v->length, out);
+        }
+
+        closeDecoder(&decoder);
+
+        return ok;
+    }
+
+    size_t bytes = v->length * sizeof(double);
+    int fd = open(v->path, O_RDONLY);
+    bool ok = ( fd >= 0 && pread(fd, out, bytes, 0) == (ssize_t) bytes );
+
+    if( fd >= 0 ) {
+        close(fd);
+    }
+
+    return ok;
+}
+
+
+/**
+ * Writes the cross product of the task's two three element operands to
+ * its result file, for storeShortResult to pick up
+ */
+static bool crossTask(mappedTask * task) {
+
+    double a[MAX_VECTOR_DIMENSION];
+    double b[MAX_VECTOR_DIMENSION];
+
+    if( ! readShort(&task->operands[0], a) || ! readShort(&task->operands[1], b) ) {
+        return false;
+    }
+
+    double c[3] = {
+        a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0],
+    };
+
+    int fd = open(task->resultPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = ( fd >= 0 && pwrite(fd, c, sizeof(c), 0) == (ssize_t) sizeof(c) );
+
+    if( fd >= 0 ) {
+        close(fd);
+    }
+
+    task->resultLength = 3;
+
+    return ok;
+}
+
+
+/**
+ * Writes a compressed vector back out to its raw file and drops the
+ * compressed copy, for a gather which can't read it in order
+ */
+static bool decompressMapped(mappedVector * v) {
+
+    mappedTask copy = { .operands = { *v }, .numOperands = 1, .length = v->length, .op = STREAM_COPY };
+    strcpy(copy.resultPath, v->path);
+
+    if( ! streamTask(&copy) ) {
+        printMessage(ANSI_COLOR_RED "Could not decompress mapped vector!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    unlink(v->packedPath);
+    v->compressed = false;
+    v->incompressible = false;
+    v->decodedValues += copy.operands[0].decodedValues;
+    v->decodeSeconds += copy.operands[0].decodeSeconds;
+
+    return true;
+}
+
+
+static bool updatesInPlace(minimatcmdType operation) {
+    return operation == ADD_ASSIGN || operation == SUB_ASSIGN ||
+           operation == AXPY || operation == SCALE_ASSIGN;
+}
+
+
+static void copyOperand(mappedVector * live, mappedVector * copy) {
+
+    live->lastUsed = commandCount;
+    *copy = *live;
+    copy->decodedValues = 0;
+    copy->decodeSeconds = 0.0;
+}
+
+
+/**
+ * Fills in add, sub, dot, the scalings, the compound assignments and the
+ * element-wise functions, which take mapped operands only
+ */
+static bool prepareArithmetic(mappedTask * task, minimatcmd cmd, const char * resultName) {
+
+    bool unary = ( cmd.operation == SCALARMUL || cmd.operation == SCALE_ASSIGN ||
+                   elementFunction(cmd.operation) != NULL );
+    mappedVector * a = findMapped(cmd.operands[0].vecName);
+    mappedVector * b = unary ? NULL : findMapped(cmd.operands[1].vecName);
+
+    // Mixing a file-backed operand with an in-memory one is not supported
+    if( a == NULL || ( ! unary && b == NULL ) ) {
+        printMessage(ANSI_COLOR_RED "Both operands must be mapped or generated vectors!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    if( b != NULL && a->length != b->length ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    if( updatesInPlace(cmd.operation) && a->generated ) {
+        printMessage(ANSI_COLOR_RED "Generators are read only, materialize them first!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    copyOperand(a, &task->operands[0]);
+    task->numOperands = 1;
+    task->length = a->length;
+
+    if( b != NULL ) {
+        copyOperand(b, &task->operands[task->numOperands++]);
+    }
+
+    task->scalar = cmd.scalar;
+    task->inPlace = updatesInPlace(cmd.operation);
+
+    if( task->inPlace ) {
+        task->op = ( cmd.operation == SCALE_ASSIGN ) ? STREAM_SCALE : STREAM_AXPY;
+        strcpy(task->resultName, a->vecName);
+
+        // In-place updates stream the result back over a's own file, but
+        // never over one the user mapped. That goes to a copy a then names
+        if( ! a->owned ) {
+            task->inPlace = false;
+            return resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath);
+        }
+
+        strcpy(task->resultPath, a->path);
+
+    } else if( cmd.operation == DOTPROD ) {
+        task->op = STREAM_DOT;
+        snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", resultName);
+
+    } else {
+        task->fn = elementFunction(cmd.operation);
+        task->fast = fastFunction(cmd.operation);
+        task->op = ( task->fn != NULL ) ? STREAM_APPLY :
+                   ( cmd.operation == ADD ) ? STREAM_ADD :
+                   ( cmd.operation == SUB ) ? STREAM_SUB : STREAM_SCALE;
+
+        // scalarmul keeps its operand's name like the in-memory version
+        snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s",
+                 ( task->op == STREAM_SCALE ) ? a->vecName : resultName);
+
+        return resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath);
+    }
+
+    return true;
+}
+
+
+/**
+ * Copies an operand of a mask or index command into the task. Operands
+ * that are not mapped are held in the task, and a single number becomes
+ * a constant generator standing for that value at every position
+ */
+static bool maskedOperand(const vector * operand, mappedVector * copy) {
+
+    mappedVector * live = findMapped(operand->vecName);
+
+    if( live != NULL ) {
+        copyOperand(live, copy);
+        return true;
+    }
+
+    vector v = *operand;
+
+    if( v.vecName[0] != '\0' && ! grabVector(&v) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    memset(copy, 0, sizeof(*copy));
+    copy->length = v.vecSize;
+
+    if( v.vecSize == 1 ) {
+        copy->generated = true;
+        copy->start = v.magnitudes[0];
+        copy->last = v.magnitudes[0];
+    } else {
+        copy->inMemory = true;
+        memcpy(copy->values, v.magnitudes, sizeof(copy->values));
+    }
+
+    return true;
+}
+
+
+/**
+ * Fills in the comparisons, where, select, compress and gather. Any of
+ * their operands may be mapped, the others are held in the task
+ */
+static bool prepareMasked(mappedTask * task, minimatcmd cmd, const char * resultName) {
+
+    vector mask = { .vecSize = 0 };
+    vector zero = { .vecSize = 1 };
+    const vector * operands[MAX_STREAM_OPERANDS] = { &cmd.operands[0], &cmd.operands[1] };
+
+    strcpy(mask.vecName, cmd.arguments); // the parser kept it short enough
+    task->numOperands = 2;
+
+    switch(cmd.operation) {
+        case GREATER:     task->op = STREAM_GREATER; break;
+        case LESS:        task->op = STREAM_LESS;    break;
+        case GATHER:      task->op = STREAM_GATHER;  break;
+
+        case WHERE:
+            task->op = STREAM_WHERE;
+            operands[0] = &mask;
+            operands[1] = &cmd.operands[0];
+            operands[2] = &cmd.operands[1];
+            task->numOperands = 3;
+            break;
+
+        // select is where with 0 for b
+        case SELECT:
+            task->op = STREAM_WHERE;
+            operands[0] = &mask;
+            operands[1] = &cmd.operands[0];
+            operands[2] = &zero;
+            task->numOperands = 3;
+            break;
+
+        default:
+            task->op = STREAM_COMPRESS;
+            operands[0] = &mask;
+            operands[1] = &cmd.operands[0];
+            break;
+    }
+
+    // Only minimat's own files lose their raw copy when compressed
+    mappedVector * source = findMapped(cmd.operands[0].vecName);
+
+    if( task->op == STREAM_GATHER && source != NULL && source->compressed && source->owned &&
+        ! decompressMapped(source) ) {
+        return false;
+    }
+
+    for(int i = 0; i < task->numOperands; ++i) {
+        if( ! maskedOperand(operands[i], &task->operands[i]) ) {
+            return false;
+        }
+    }
+
+    // The indices drive a gather, otherwise the longest operand does and
+    // numbers and one element vectors are spread over its length
+    int firstStreamed = ( task->op == STREAM_GATHER ) ? 1 : 0;
+
+    for(int i = firstStreamed; i < task->numOperands; ++i) {
+        if( task->operands[i].length > task->length ) {
+            task->length = task->operands[i].length;
+        }
+    }
+
+    for(int i = firstStreamed; i < task->numOperands; ++i) {
+        mappedVector * v = &task->operands[i];
+
+        if( v->inMemory && v->length == 1 ) {
+            v->inMemory = false;
+            v->generated = true;
+            v->start = v->values[0];
+            v->last = v->values[0];
+        }
+
+        if( v->generated && v->length == 1 && v->step == 0.0 ) {
+            v->length = task->length;
+        }
+
+        if( v->length != task->length ) {
+            printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+            return false;
+        }
+    }
+
+    snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", resultName);
+
+    if( ! resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath) ) {
+        return false;
+    }
+
+    // A gather can't write over the file it reads at random
+    if( task->op == STREAM_GATHER && strcmp(task->resultPath, task->operands[0].path) == 0 ) {
+        return resultPath(task->resultName, ALTERNATE_RESULT_SUFFIX, task->resultPath);
+    }
+
+    return true;
+}
+
+
+/**
+ * Fills in sort, argsort, cumsum and cumprod of a mapped operand
+ */
+static bool prepareOrdered(mappedTask * task, minimatcmd cmd, const char * resultName) {
+
+    mappedVector * a = findMapped(cmd.operands[0].vecName);
+
+    if( a == NULL ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    copyOperand(a, &task->operands[0]);
+    task->numOperands = 1;
+    task->length = a->length;
+    task->op = ( cmd.operation == SORT ) ? STREAM_SORT :
+               ( cmd.operation == ARGSORT ) ? STREAM_ARGSORT :
+               ( cmd.operation == CUMSUM ) ? STREAM_CUMSUM : STREAM_CUMPROD;
+    snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", resultName);
+
+    if( ! resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath) ) {
+        return false;
+    }
+
+    if( task->op == STREAM_CUMSUM || task->op == STREAM_CUMPROD ) {
+        return true;
+    }
+
+    // A single pass would write the result while still reading the source
+    if( strcmp(task->resultPath, a->path) == 0 &&
+        ! resultPath(task->resultName, ALTERNATE_RESULT_SUFFIX, task->resultPath) ) {
+        return false;
+    }
+
+    return resultPath(task->resultName, SORT_SCRATCH_SUFFIX_A, task->scratchPaths[0]) &&
+           resultPath(task->resultName, SORT_SCRATCH_SUFFIX_B, task->scratchPaths[1]);
+}
+
+
+/**
+ * Fills in "b = x" of a mapped x, a copy streamed into the result
+ * directory under b's name whatever name the result was asked for
+ */
+static bool prepareCopy(mappedTask * task, minimatcmd cmd) {
+
+    mappedVector * source = findMapped(cmd.operands[1].vecName);
+
+    if( source == NULL ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    copyOperand(source, &task->operands[0]);
+    task->numOperands = 1;
+    task->length = source->length;
+    task->op = STREAM_COPY;
+    snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", cmd.operands[0].vecName);
+
+    if( ! resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath) ) {
+        return false;
+    }
+
+    // "x = x" would copy the file over itself
+    if( strcmp(task->resultPath, source->path) == 0 ) {
+        return resultPath(task->resultName, ALTERNATE_RESULT_SUFFIX, task->resultPath);
+    }
+
+    return true;
+}
+
+
+/**
+ * Fills in the cross product, of mapped or in-memory operands
+ */
+static bool prepareCross(mappedTask * task, minimatcmd cmd, const char * resultName) {
+
+    if( ! maskedOperand(&cmd.operands[0], &task->operands[0]) ||
+        ! maskedOperand(&cmd.operands[1], &task->operands[1]) ) {
+        return false;
+    }
+
+    if( task->operands[0].length != 3 || task->operands[1].length != 3 ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have proper dimension!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    task->numOperands = 2;
+    task->length = 3;
+    task->op = STREAM_XPROD;
+    snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", resultName);
+
+    return resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath);
+}
+
+
+/**
+ * Takes rand, randn or randi's run of the sequence now, in command order,
+ * to be filled in by the stream
+ */
+static bool prepareRandom(mappedTask * task, minimatcmd cmd, const char * resultName) {
+
+    const double * args = cmd.operands[0].magnitudes;
+    double n = ( cmd.operation == RANDI ) ? args[2] : args[0];
+    randomKind kind = ( cmd.operation == RAND ) ? RANDOM_UNIFORM :
+                      ( cmd.operation == RANDN ) ? RANDOM_NORMAL : RANDOM_INTEGER;
+
+    // Checked before the cast, converting a count out of range is undefined
+    if( n != floor(n) || n > (double) ( SIZE_MAX / sizeof(double) ) ) {
+        printMessage(ANSI_COLOR_RED "Vector size is out of range!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    task->op = STREAM_RANDOM;
+    task->length = (size_t) n;
+    snprintf(task->resultName, MAX_VECTOR_NAME_LEN, "%s", resultName);
+
+    return resultPath(task->resultName, MAPPED_RESULT_SUFFIX, task->resultPath) &&
+           startRandomRun(&task->random, kind, args[0], args[1], task->length);
+}
+
+
+static bool ordersOrScans(minimatcmdType operation) {
+    return operation == SORT || operation == ARGSORT || operation == CUMSUM || operation == CUMPROD;
+}
+
+
+static bool masksOrIndexes(minimatcmdType operation) {
+    return operation == GREATER || operation == LESS || operation == WHERE ||
+           operation == SELECT || operation == COMPRESS_MASKED || operation == GATHER;
+}
+
+
+mappedTask * prepareMappedCmd( minimatcmd cmd, const char * resultName ) {
+
+    mappedTask * task = calloc(1, sizeof(mappedTask));
+
+    if( task == NULL ) {
+        printMessage(ANSI_COLOR_RED "Out of memory!" ANSI_COLOR_RESET);
+        return NULL;
+    }
+
+    bool prepared;
+
+    if( cmd.operation == RAND || cmd.operation == RANDN || cmd.operation == RANDI ) {
+        prepared = prepareRandom(task, cmd, resultName);
+    } else if( cmd.operation == DATA_COPY ) {
+        prepared = prepareCopy(task, cmd);
+    } else if( cmd.operation == XPROD ) {
+        prepared = prepareCross(task, cmd, resultName);
+    } else if( masksOrIndexes(cmd.operation) ) {
+        prepared = prepareMasked(task, cmd, resultName);
+    } else if( ordersOrScans(cmd.operation) ) {
+        prepared = prepareOrdered(task, cmd, resultName);
+    } else {
+        prepared = prepareArithmetic(task, cmd, resultName);
+    }
+
+    if( ! prepared ) {
+        free(task);
+        return NULL;
+    }
+
+    return task;
+}
+
+
+void runMappedTask( mappedTask * task ) {
+
+    bool sorting = ( task->op == STREAM_SORT || task->op == STREAM_ARGSORT );
+
+    task->ok = sorting ? sortTask(task) :
+               ( task->op == STREAM_XPROD ) ? crossTask(task) : streamTask(task);
+}
+
+
+// Decode time spent on a copy counts toward the vector it was copied from
+static void foldDecodeStats(const mappedVector * copy) {
+
+    mappedVector * live = findMapped(copy->vecName);
+
+    if( live != NULL && live->compressed ) {
+        live->decodedValues += copy->decodedValues;
+        live->decodeSeconds += copy->decodeSeconds;
+    }
+}
+
+
+/**
+ * A result short enough to be an ordinary vector is stored as one, like
+ * a short generator is when materialized
+ */
+static bool storeShortResult(const mappedTask * task) {
+
+    vector result = { .vecSize = (int) task->resultLength };
+    size_t bytes = task->resultLength * sizeof(double);
+    int fd = open(task->resultPath, O_RDONLY);
+    bool ok = ( fd >= 0 && pread(fd, result.magnitudes, bytes, 0) == (ssize_t) bytes );
+
+    if( fd >= 0 ) {
+        close(fd);
+    }
+
+    unlink(task->resultPath);
+
+    if( ! ok ) {
+        return false;
+    }
+
+    strcpy(result.vecName, task->resultName);
+    unmapVector(result.vecName);
+    addVectorToMemoryList(result);
+    printVector(result);
+
+    return true;
+}
+
+
+bool finishMappedTask( mappedTask * task ) {
+
+    for(int i = 0; i < task->numOperands; ++i) {
+        foldDecodeStats(&task->operands[i]);
+    }
+
+    bool ok = task->ok;
+
+    if( ! ok ) {
+        if( task->error != NULL ) {
+            char line[128];
+            snprintf(line, sizeof(line), ANSI_COLOR_RED "%s" ANSI_COLOR_RESET, task->error);
+            printMessage(line);
+        } else if( task->op == STREAM_DOT ) {
+            printMessage(ANSI_COLOR_RED "Could not read mapped vectors!" ANSI_COLOR_RESET);
+        } else {
+            printMessage(ANSI_COLOR_RED "Could not write mapped result!" ANSI_COLOR_RESET);
+        }
+
+    } else if( task->op == STREAM_DOT ) {
+        vector ans;
+        strcpy(ans.vecName, task->resultName);
+        ans.vecSize = 1;
+        ans.magnitudes[0] = task->dot;
+
+        unmapVector(ans.vecName);
+        addVectorToMemoryList(ans);
+        printVector(ans);
+
+    } else if( task->inPlace ) {
+        mappedVector * a = findMapped(task->resultName);
+
+        // The compressed copy is stale now, the file is current again
+        if( a != NULL && a->compressed ) {
+            unlink(a->packedPath);
+            a->compressed = false;
+            a->incompressible = false;
+            a->decodedValues = 0;
+            a->decodeSeconds = 0.0;
+        }
+
+        if( a != NULL ) {
+            printMapped(a);
+        }
+
+    } else if( task->resultLength <= MAX_VECTOR_DIMENSION ) {
+        ok = storeShortResult(task);
+
+        if( ! ok ) {
+            printMessage(ANSI_COLOR_RED "Could not read mapped result!" ANSI_COLOR_RESET);
+        }
+
+    } else if( bindFile(task->resultName, task->resultPath, true) ) {
+        printMapped(findMapped(task->resultName));
+
+    } else {
+        printMessage(ANSI_COLOR_RED "Could not write mapped result!" ANSI_COLOR_RESET);
+        ok = false;
+    }
+
+    free(task);
+
+    return ok;
+}
+
+
+bool executeMappedCmd( minimatcmd cmd ) {
+
+    mappedTask * task = prepareMappedCmd(cmd, "ans");
+
+    if( task == NULL ) {
+        return false;
+    }
+
+    runMappedTask(task);
+
+    return finishMappedTask(task);
+}
+
+
+bool materializeVector( const char * name ) {
+
+    mappedVector * v = findMapped(name);
+
+    if( v == NULL || ! v->generated ) {
+        printMessage(ANSI_COLOR_RED "Only generators can be materialized!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    // Short enough to become an ordinary vector
+    if( v->length <= MAX_VECTOR_DIMENSION ) {
+        vector result = { .vecSize = (int) v->length };
+        strcpy(result.vecName, name);
+
+        for(size_t i = 0; i < v->length; ++i) {
+            result.magnitudes[i] = generatedElement(v, i);
+        }
+
+        unmapVector(name);
+
+        if( ! addVectorToMemoryList(result) ) {
+            return false;
+        }
+
+        printVector(result);
+
+        return true;
+    }
+
+    mappedTask copy = { .operands = { *v }, .numOperands = 1, .length = v->length, .op = STREAM_COPY };
+
+    if( ! resultPath(name, MAPPED_RESULT_SUFFIX, copy.resultPath) ) {
+        return false;
+    }
+
+    if( ! streamTask(&copy) || ! bindFile(name, copy.resultPath, true) ) {
+        printMessage(ANSI_COLOR_RED "Could not write mapped result!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    printMapped(findMapped(name));
+
+    return true;
+}
+
+
+/**
+ * Rewrites one file-backed vector compressed, keeping it only if smaller
+ */
+static void compressMapped(mappedVector * v) {
+
+    size_t packedBytes;
+    size_t rawBytes = v->length * sizeof(double);
+
+    if( ! resultPath(v->vecName, COMPRESSED_SUFFIX, v->packedPath) ) {
+        v->incompressible = true;
+        return;
+    }
+
+    if( ! compressFile(v->path, v->length, v->packedPath, &packedBytes) || packedBytes >= rawBytes ||
+        ! verifyCompressed(v->path, v->length, v->packedPath) ) {
+        unlink(v->packedPath);
+        v->incompressible = true;
+        return;
+    }
+
+    v->compressed = true;
+    v->packedBytes = packedBytes;
+
+    // A file minimat wrote is only taking up space now, decompressMapped
+    // writes it again if it is ever needed. The user's own file is kept
+    if( v->owned ) {
+        unlink(v->path);
+        return;
+    }
+
+    // The raw pages are no longer read, let the kernel drop them now
+    int fd = open(v->path, O_RDONLY);
+
+    if( fd >= 0 ) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+void setCompressCold( bool enabled ) {
+    compressCold = enabled;
+}
+
+
+void setFastMath( bool enabled ) {
+    fastMath = enabled;
+}
+
+
+void compressColdVectors( void ) {
+
+    ++commandCount;
+
+    for(int i = 0; compressCold && i < numMapped; ++i) {
+        mappedVector * v = &mappedVectors[i];
+
+        if( readsFile(v) && ! v->incompressible && commandCount - v->lastUsed >= COLD_AFTER_COMMANDS ) {
+            compressMapped(v);
+        }
+    }
+}
+
+
+void printMappedVectors( void ) {
+
+    char line[MAX_VECTOR_NAME_LEN + 128];
+
+    for(int i = 0; i < numMapped; ++i) {
+        const mappedVector * v = &mappedVectors[i];
+        double rawBytes = (double) v->length * sizeof(double);
+
+        if( v->generated || v->borrowed != NULL ) {
+            snprintf(line, sizeof(line), "\t%-16s %12zu  %-10s %12d", v->vecName, v->length,
+                     v->generated ? "generated" : "borrowed", 0);
+        } else if( ! v->compressed ) {
+            snprintf(line, sizeof(line), "\t%-16s %12zu  %-10s %12.0f", v->vecName, v->length, "file", rawBytes);
+        } else if( v->decodedValues == 0 ) {
+            snprintf(line, sizeof(line), "\t%-16s %12zu  %-10s %12zu %7.1fx", v->vecName, v->length,
+                     "compressed", v->packedBytes, rawBytes / v->packedBytes);
+        } else {
+            double megabytes = v->decodedValues * sizeof(double) / 1e6;
+            snprintf(line, sizeof(line), "\t%-16s %12zu  %-10s %12zu %7.1fx %8.0f MB/s", v->vecName, v->length,
+                     "compressed", v->packedBytes, rawBytes / v->packedBytes,
+                     megabytes / ( v->decodeSeconds > 0.0 ? v->decodeSeconds : 1e-9 ));
+        }
+
+        printMessage(line);
+    }
+}
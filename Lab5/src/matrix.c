@@ -0,0 +1,319 @@
+/**
+ * @file matrix.c
+ * @brief Square matrices built from stored vectors, with cached LU and
+ * Cholesky factorizations for repeated solves
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - "matrix A r1 r2 r3" copies the named vectors in as rows
+ *  - "solve A b" factors A once (Cholesky if already computed, otherwise
+ *    LU with partial pivoting) and reuses the factors on later solves
+ *  - Each solve after the first is two triangular substitutions
+ */
+
+#include "matrix.h"
+#include "termcolors.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MATRIX_LINE_LEN 160
+
+static matrix storedMatrices[MAX_MATRICES];
+static int numMatrices = 0;
+
+
+static matrix * findMatrix(const char * name) {
+
+    for(int i = 0; i < numMatrices; ++i) {
+        if( strcmp(storedMatrices[i].matName, name) == 0 ) {
+            return &storedMatrices[i];
+        }
+    }
+
+    printMessage(ANSI_COLOR_RED "Matrix does not exist!" ANSI_COLOR_RESET);
+
+    return NULL;
+}
+
+
+static void printRows(const char * name, double rows[][MAX_VECTOR_DIMENSION], int size) {
+
+    char line[MATRIX_LINE_LEN];
+
+    snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s =" ANSI_COLOR_RESET, name);
+    printMessage(line);
+
+    for(int r = 0; r < size; ++r) {
+        int len = snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t\t");
+
+        for(int c = 0; c < size; ++c) {
+            len += snprintf(line + len, sizeof(line) - len, ( c == 0 ) ? "%f" : " %f", rows[r][c]);
+        }
+
+        snprintf(line + len, sizeof(line) - len, ANSI_COLOR_RESET);
+        printMessage(line);
+    }
+}
+
+
+bool createMatrix( const char * name, const char * rowNames ) {
+
+    matrix result = { .matSize = 0 };
+    strcpy(result.matName, name);
+
+    char names[strlen(rowNames) + 1];
+    strcpy(names, rowNames);
+
+    int numRows = 0;
+
+    for(char * token = strtok(names, " "); token != NULL; token = strtok(NULL, " ")) {
+
+        vector row;
+
+        if( numRows == MAX_VECTOR_DIMENSION || strlen(token) >= MAX_VECTOR_NAME_LEN ) {
+            printMessage(ANSI_COLOR_RED "Too many rows for a matrix!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        strcpy(row.vecName, token);
+
+        if( ! grabVector(&row) ) {
+            printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        if( numRows > 0 && row.vecSize != result.matSize ) {
+            printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        memcpy(result.entries[numRows], row.magnitudes, sizeof(result.entries[0]));
+        result.matSize = row.vecSize;
+        ++numRows;
+    }
+
+    if( numRows != result.matSize ) {
+        printMessage(ANSI_COLOR_RED "Matrix must be square!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    // Replacing the struct drops any factorization of the old value
+    matrix * slot = NULL;
+
+    for(int i = 0; i < numMatrices; ++i) {
+        if( strcmp(storedMatrices[i].matName, name) == 0 ) {
+            slot = &storedMatrices[i];
+        }
+    }
+
+    if( slot == NULL ) {
+
+        if( numMatrices == MAX_MATRICES ) {
+            printMessage(ANSI_COLOR_RED "Matrix memory is full!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        slot = &storedMatrices[numMatrices++];
+    }
+
+    *slot = result;
+    printRows(slot->matName, slot->entries, slot->matSize);
+
+    return true;
+}
+
+
+static bool factorLU(matrix * m) {
+
+    int n = m->matSize;
+
+    memcpy(m->lu, m->entries, sizeof(m->lu));
+
+    for(int i = 0; i < n; ++i) {
+        m->pivots[i] = i;
+    }
+
+    for(int k = 0; k < n; ++k) {
+
+        // Partial pivoting on the largest remaining entry of the column
+        int best = k;
+        for(int r = k + 1; r < n; ++r) {
+            if( fabs(m->lu[r][k]) > fabs(m->lu[best][k]) ) {
+                best = r;
+            }
+        }
+
+        if( fabs(m->lu[best][k]) < SINGULAR_TOLERANCE ) {
+            return false;
+        }
+
+        if( best != k ) {
+            double row[MAX_VECTOR_DIMENSION];
+            memcpy(row, m->lu[k], sizeof(row));
+            memcpy(m->lu[k], m->lu[best], sizeof(row));
+            memcpy(m->lu[best], row, sizeof(row));
+
+            int pivot = m->pivots[k];
+            m->pivots[k] = m->pivots[best];
+            m->pivots[best] = pivot;
+        }
+
+        for(int r = k + 1; r < n; ++r) {
+            m->lu[r][k] /= m->lu[k][k];
+
+            for(int c = k + 1; c < n; ++c) {
+                m->lu[r][c] -= m->lu[r][k] * m->lu[k][c];
+            }
+        }
+    }
+
+    m->luValid = true;
+
+    return true;
+}
+
+
+static bool factorCholesky(matrix * m) {
+
+    int n = m->matSize;
+
+    memset(m->chol, 0, sizeof(m->chol));
+
+    for(int r = 0; r < n; ++r) {
+        for(int c = 0; c < r; ++c) {
+            if( m->entries[r][c] != m->entries[c][r] ) {
+                return false;
+            }
+        }
+    }
+
+    for(int c = 0; c < n; ++c) {
+
+        double diagonal = m->entries[c][c];
+        for(int k = 0; k < c; ++k) {
+            diagonal -= m->chol[c][k] * m->chol[c][k];
+        }
+
+        if( diagonal < SINGULAR_TOLERANCE ) {
+            return false;
+        }
+
+        m->chol[c][c] = sqrt(diagonal);
+
+        for(int r = c + 1; r < n; ++r) {
+            double sum = m->entries[r][c];
+
+            for(int k = 0; k < c; ++k) {
+                sum -= m->chol[r][k] * m->chol[c][k];
+            }
+
+            m->chol[r][c] = sum / m->chol[c][c];
+        }
+    }
+
+    m->cholValid = true;
+
+    return true;
+}
+
+
+vector solve( const char * name, vector b ) {
+
+    vector failed = { .vecSize = 0 };
+    matrix * m = findMatrix(name);
+
+    if( m == NULL ) {
+        return failed;
+    }
+
+    if( ! grabVector(&b) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failed;
+    }
+
+    if( b.vecSize != m->matSize ) {
+        printMessage(ANSI_COLOR_RED "Vector does not match matrix dimension!" ANSI_COLOR_RESET);
+        return failed;
+    }
+
+    int n = m->matSize;
+    double y[MAX_VECTOR_DIMENSION];
+    vector x;
+
+    if( m->cholValid ) {
+
+        // L y = b, then L^T x = y
+        for(int r = 0; r < n; ++r) {
+            y[r] = b.magnitudes[r];
+            for(int k = 0; k < r; ++k) {
+                y[r] -= m->chol[r][k] * y[k];
+            }
+            y[r] /= m->chol[r][r];
+        }
+
+        for(int r = n - 1; r >= 0; --r) {
+            x.magnitudes[r] = y[r];
+            for(int k = r + 1; k < n; ++k) {
+                x.magnitudes[r] -= m->chol[k][r] * x.magnitudes[k];
+            }
+            x.magnitudes[r] /= m->chol[r][r];
+        }
+
+    } else {
+
+        if( ! m->luValid && ! factorLU(m) ) {
+            printMessage(ANSI_COLOR_RED "Matrix is singular!" ANSI_COLOR_RESET);
+            return failed;
+        }
+
+        // L y = P b, then U x = y
+        for(int r = 0; r < n; ++r) {
+            y[r] = b.magnitudes[m->pivots[r]];
+            for(int k = 0; k < r; ++k) {
+                y[r] -= m->lu[r][k] * y[k];
+            }
+        }
+
+        for(int r = n - 1; r >= 0; --r) {
+            x.magnitudes[r] = y[r];
+            for(int k = r + 1; k < n; ++k) {
+                x.magnitudes[r] -= m->lu[r][k] * x.magnitudes[k];
+            }
+            x.magnitudes[r] /= m->lu[r][r];
+        }
+    }
+
+    strcpy(x.vecName, "ans");
+    x.vecSize = n;
+
+    return x;
+}
+
+
+bool chol( const char * name ) {
+
+    matrix * m = findMatrix(name);
+
+    if( m == NULL ) {
+        return false;
+    }
+
+    if( ! m->cholValid && ! factorCholesky(m) ) {
+        printMessage(ANSI_COLOR_RED "Matrix is not symmetric positive definite!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    printRows("L", m->chol, m->matSize);
+
+    return true;
+}
+
+
+void clearMatrices( void ) {
+    numMatrices = 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file memo.c
+ * @brief Bounded cache of operation results keyed on operand versions
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Every store gives a vector a new version, so (operation, operand
+ *    slots, operand versions, scalar) pins down the result exactly
+ *  - The cache is a direct-mapped table sized to fit the memory budget,
+ *    a colliding result simply replaces the older one
+ *  - Hits are counted with the result bytes they handed back
+ */
+
+#include "memo.h"
+#include "termcolors.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMO_LINE_LEN 120
+
+typedef struct {
+
+    bool valid;
+    memoKey key;
+    vector result;
+
+} memoEntry;
+
+// Shared by -j batch workers
+static pthread_mutex_t memoLock = PTHREAD_MUTEX_INITIALIZER;
+static memoEntry * entries = NULL;
+static size_t numEntries = 0;
+static size_t budget = DEFAULT_MEMO_BUDGET;
+static uint64_t lookups = 0;
+static uint64_t hits = 0;
+static uint64_t bytesSaved = 0;
+
+
+bool memoKeyFor( const minimatcmd * cmd, memoKey * key ) {
+
+    int numOperands;
+
+    switch(cmd->operation) {
+
+        case ADD:
+        case SUB:
+        case DOTPROD:
+        case XPROD:
+            numOperands = 2;
+            break;
+
+        case SCALARMUL:
+        case SORT:
+        case ARGSORT:
+        case CUMSUM:
+        case CUMPROD:
+        case SQRT:
+        case EXP:
+        case LOG:
+        case SIN:
+        case COS:
+        case TANH:
+        case ABS:
+            numOperands = 1;
+            break;
+
+        // Everything else has side effects or reads more than named vectors
+        default:
+            return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->operation = cmd->operation;
+    key->scalar = ( cmd->operation == SCALARMUL ) ? cmd->scalar : 0.0;
+
+    for(int i = 0; i < numOperands; ++i) {
+        vectorHandle handle;
+
+        if( ! findVector(cmd->operands[i].vecName, &handle) ) {
+            return false;
+        }
+
+        key->operandSlots[i] = handle.index;
+        key->operandVersions[i] = vectorVersion(handle);
+    }
+
+    return true;
+}
+
+
+static size_t bucketFor(const memoKey * key) {
+
+    uint64_t hash = key->operation;
+
+    for(int i = 0; i < MAX_NUM_OPERANDS; ++i) {
+        hash = ( hash ^ key->operandVersions[i] ) * 0x100000001B3ULL;
+    }
+
+    uint64_t scalarBits;
+    memcpy(&scalarBits, &key->scalar, sizeof(scalarBits));
+    hash = ( hash ^ scalarBits ) * 0x100000001B3ULL;
+
+    return ( hash ^ ( hash >> 29 ) ) % numEntries;
+}
+
+
+static bool sameKey(const memoKey * a, const memoKey * b) {
+
+    return a->operation == b->operation &&
+           memcmp(a->operandSlots, b->operandSlots, sizeof(a->operandSlots)) == 0 &&
+           memcmp(a->operandVersions, b->operandVersions, sizeof(a->operandVersions)) == 0 &&
+           memcmp(&a->scalar, &b->scalar, sizeof(a->scalar)) == 0;
+}
+
+
+/**
+ * Allocates the table on first use. Called with memoLock held.
+ */
+static bool ensureTable( void ) {
+
+    if( entries == NULL && budget >= sizeof(memoEntry) ) {
+        numEntries = budget / sizeof(memoEntry);
+        entries = calloc(numEntries, sizeof(memoEntry));
+    }
+
+    return entries != NULL;
+}
+
+
+bool memoLookup( const memoKey * key, vector * ans ) {
+
+    bool found = false;
+
+    pthread_mutex_lock(&memoLock);
+
+    if( ensureTable() ) {
+        memoEntry * entry = &entries[bucketFor(key)];
+
+        ++lookups;
+
+        if( entry->valid && sameKey(&entry->key, key) ) {
+            *ans = entry->result;
+            bytesSaved += entry->result.vecSize * sizeof(double);
+            ++hits;
+            found = true;
+        }
+    }
+
+    pthread_mutex_unlock(&memoLock);
+
+    return found;
+}
+
+
+void memoStore( const memoKey * key, const vector * ans ) {
+
+    pthread_mutex_lock(&memoLock);
+
+    if( ensureTable() ) {
+        memoEntry * entry = &entries[bucketFor(key)];
+
+        entry->valid = true;
+        entry->key = *key;
+        entry->result = *ans;
+    }
+
+    pthread_mutex_unlock(&memoLock);
+}
+
+
+void setMemoBudget( size_t bytes ) {
+
+    pthread_mutex_lock(&memoLock);
+
+    // Rebuilt at the new size on next use, a budget under one entry disables it
+    free(entries);
+    entries = NULL;
+    numEntries = 0;
+    budget = bytes;
+
+    pthread_mutex_unlock(&memoLock);
+}
+
+
+void printMemoStats( void ) {
+
+    char line[MEMO_LINE_LEN];
+
+    pthread_mutex_lock(&memoLock);
+
+    double hitRate = ( lookups > 0 ) ? 100.0 * hits / lookups : 0.0;
+
+    snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\tcache: %llu/%llu hits (%.1f%%), %llu bytes saved, "
+             "budget %zu bytes (%zu entries)" ANSI_COLOR_RESET,
+             (unsigned long long) hits, (unsigned long long) lookups, hitRate,
+             (unsigned long long) bytesSaved, budget, budget / sizeof(memoEntry));
+
+    pthread_mutex_unlock(&memoLock);
+
+    printMessage(line);
+}
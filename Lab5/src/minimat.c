@@ -1,6 +1,6 @@
 /**
  * @file minimat.c
- * @brief Runs the minimat runtime and parser
+ * @brief The minimat runtime and parser
  * 
  * Course: CPE2600
  * Section: 011
@@ -16,17 +16,111 @@
 
 #include "minimatcmd.h"
 #include "termcolors.h"
+#include "jit.h"
+#include "mapped.h"
+#include "random.h"
+#include "profile.h"
+#include "matrix.h"
+#include "memo.h"
+#include "pairwise.h"
+#include "kmeans.h"
+#include "script.h"
+#include "stream.h"
+#include "jobs.h"
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 
 
-#define INPUT_BUFFER_SIZE 100
+typedef struct {
+    const char * keyword;
+    minimatcmdType operation;
+} minimatKeyword;
 
+// Commands written as "keyword operand" rather than with an operator symbol
+static const minimatKeyword unaryKeywords[] = {
+    { SORT_KEYWORD,    SORT },
+    { ARGSORT_KEYWORD, ARGSORT },
+    { CUMSUM_KEYWORD,  CUMSUM },
+    { CUMPROD_KEYWORD, CUMPROD },
+    { SQRT_KEYWORD,    SQRT },
+    { EXP_KEYWORD,     EXP },
+    { LOG_KEYWORD,     LOG },
+    { SIN_KEYWORD,     SIN },
+    { COS_KEYWORD,     COS },
+    { TANH_KEYWORD,    TANH },
+    { ABS_KEYWORD,     ABS },
+    { CHOL_KEYWORD,    CHOL },
+    { STATS_KEYWORD,   STREAM_STATS },
+};
 
-static vector createVectorFromConsole(char * head) {
+#define NUM_UNARY_KEYWORDS ( sizeof(unaryKeywords) / sizeof(unaryKeywords[0]) )
+
+typedef struct {
+    const char * keyword;
+    minimatcmdType operation;
+    int numArguments;
+} minimatNumericKeyword;
+
+// Commands written as "keyword number..." with a fixed number of numbers
+static const minimatNumericKeyword numericKeywords[] = {
+    { RAND_KEYWORD,  RAND,  1 },
+    { RANDN_KEYWORD, RANDN, 1 },
+    { RANDI_KEYWORD, RANDI, 3 },
+    { SEED_KEYWORD,  SEED,  1 },
+};
+
+#define NUM_NUMERIC_KEYWORDS ( sizeof(numericKeywords) / sizeof(numericKeywords[0]) )
+
+
+static bool isGeneratorKeyword(const char * word) {
+
+    return strcmp(word, RANGE_KEYWORD) == 0 || strcmp(word, LINSPACE_KEYWORD) == 0 ||
+           strcmp(word, ZEROS_KEYWORD) == 0 || strcmp(word, ONES_KEYWORD) == 0;
+}
+
+
+/**
+ * "name = generator args..." where the generator's up to three numeric
+ * arguments follow in the remaining tokens
+ */
+static minimatcmd gatherGenerator(const char * name, const char * kind) {
+    minimatcmd cmd = { .operation = CMD_ERROR };
+    char * token = strtok(NULL, " ");
+    int numArgs = 0;
+
+    while( token != NULL ) {
+        if( numArgs == MAX_VECTOR_DIMENSION ||
+            sscanf(token, "%lf", &cmd.operands[1].magnitudes[numArgs]) != 1 ) {
+            return cmd;
+        }
+
+        ++numArgs;
+        token = strtok(NULL, " ");
+    }
+
+    strcpy(cmd.operands[0].vecName, name);
+    strcpy(cmd.arguments, kind);
+    cmd.operands[1].vecSize = numArgs;
+    cmd.operation = GENERATOR_CREATE;
+
+    return cmd;
+}
+
+
+static minimatcmd createVectorFromConsole(char * head) {
+    minimatcmd cmd;
     vector result;
+
+    // Generators may also be written like calls, "linspace(0, 1, 100)"
+    for(char * c = head; *c != '\0'; ++c) {
+        if( *c == '(' || *c == ')' || *c == ',' ) {
+            *c = ' ';
+        }
+    }
     
     volatile char * token;
     token = strtok(head, " ");
@@ -37,22 +131,26 @@ static vector createVectorFromConsole(char * head) {
     token = strtok(NULL, " "); // Parse equals sign
     token = strtok(NULL, " "); // Parse first floating point token
 
-    char vectorName[50];
-
-    // If assigning to other vector then short circuit
-    sscanf((char *)token, "%s", vectorName);
-    vector toLookFor;
-    strcpy(toLookFor.vecName, vectorName);
+    if( token == NULL ) {
+        cmd.operation = CMD_ERROR;
+        return cmd;
+    }
 
-    if( grabVector(&toLookFor) ) { // Look for if vector exists
-        
-        // assign properties of vector to result (copy all but name)
-        copyVectorKeepName(&toLookFor, &result);
+    if( isGeneratorKeyword((char *) token) ) {
+        return gatherGenerator(result.vecName, (char *) token);
+    }
 
-        return result;
+    // If assigning to other vector then the copy is made when executed, so
+    // it sees the source as it is then rather than at parse time
+    double first;
+    if( sscanf((char *)token, "%lf", &first) != 1 ) {
+        cmd.operands[0] = result;
+        snprintf(cmd.operands[1].vecName, MAX_VECTOR_NAME_LEN, "%s", (char *)token);
+        cmd.operation = DATA_COPY;
+        return cmd;
     }
 
-    while( token != NULL ) {
+    while( token != NULL && dimensionCounter < MAX_VECTOR_DIMENSION ) {
 
         if(sscanf(( char * )token, "%lf", &result.magnitudes[dimensionCounter]) == 1) {
             ++dimensionCounter;
@@ -66,27 +164,38 @@ static vector createVectorFromConsole(char * head) {
     // Fill in number of dimensions the vector is
     result.vecSize = dimensionCounter;
 
-    return result;
+    cmd.operands[0] = result;
+    cmd.operation = DATA_CREATE;
+
+    return cmd;
 }
 
 
 static minimatcmd gatherOperandsOperation(char * head, char operation) {
-    minimatcmd cmd;
+    minimatcmd cmd = { .operation = CMD_ERROR };
     
     char * token = strtok(head, " ");
 
     // Copy name of first operand vector
+    if( token == NULL || strlen(token) >= MAX_VECTOR_NAME_LEN ) {
+        return cmd;
+    }
+
     strcpy((char *) &cmd.operands[0].vecName, token);
     token = strtok(NULL, " ");
 
     // Check for formatting
-    if( *token != operation ) {
-        cmd.operation = CMD_ERROR;
+    if( token == NULL || *token != operation ) {
         return cmd;
     }
 
     // Copy name of second operand vector
     token = strtok(NULL, " ");
+
+    if( token == NULL || strlen(token) >= MAX_VECTOR_NAME_LEN ) {
+        return cmd;
+    }
+
     strcpy((char *)&cmd.operands[1].vecName, token);
 
     if( sscanf(cmd.operands[1].vecName, "%lf", &cmd.scalar) == 1 ) {
@@ -99,47 +208,504 @@ static minimatcmd gatherOperandsOperation(char * head, char operation) {
 }
 
 
-static minimatcmd minimatProcessCmd( char * cmdInput ) {
-
+static minimatcmd gatherUnaryOperand(char * head, minimatcmdType operation) {
     minimatcmd cmd;
-    cmd.operation = CMD_ERROR;
+
+    strtok(head, " "); // Parse keyword
+    char * token = strtok(NULL, " ");
+
+    // Keyword commands need exactly one operand name
+    if( token == NULL || strlen(token) >= MAX_VECTOR_NAME_LEN ) {
+        cmd.operation = CMD_ERROR;
+        return cmd;
+    }
+
+    strcpy(cmd.operands[0].vecName, token);
+    cmd.operation = operation;
+
+    return cmd;
+}
+
+
+static minimatcmd gatherNumericArguments(char * head, minimatcmdType operation, int count) {
+    minimatcmd cmd = { .operation = CMD_ERROR };
+
+    strtok(head, " "); // Parse keyword
+    char * token = strtok(NULL, " ");
+
+    int parsed = 0;
+
+    // Arguments are kept in the first operand like a vector literal
+    while( token != NULL && parsed < count ) {
+        if( sscanf(token, "%lf", &cmd.operands[0].magnitudes[parsed]) != 1 ) {
+            return cmd;
+        }
+
+        ++parsed;
+        token = strtok(NULL, " ");
+    }
+
+    if( parsed != count || token != NULL ) {
+        return cmd;
+    }
+
+    cmd.operands[0].vecSize = count;
+    cmd.operation = operation;
+
+    return cmd;
+}
+
+
+static minimatcmd gatherSetting(char * head, minimatcmdType operation) {
+    minimatcmd cmd = gatherUnaryOperand(head, operation);
+
+    // Settings take on/off in place of an operand name
+    if( cmd.operation != CMD_ERROR && strcmp(cmd.operands[0].vecName, ON_KEYWORD) == 0 ) {
+        cmd.scalar = 1;
+    } else if( cmd.operation != CMD_ERROR && strcmp(cmd.operands[0].vecName, OFF_KEYWORD) == 0 ) {
+        cmd.scalar = 0;
+    } else {
+        cmd.operation = CMD_ERROR;
+    }
+
+    return cmd;
+}
+
+
+static minimatcmd gatherFileOperand(char * head, minimatcmdType operation) {
+    minimatcmd cmd = gatherUnaryOperand(head, operation);
+    char * token = strtok(NULL, " ");
+
+    // File commands are "keyword name path"
+    if( cmd.operation == CMD_ERROR || token == NULL ) {
+        cmd.operation = CMD_ERROR;
+        return cmd;
+    }
+
+    strcpy(cmd.arguments, token);
+
+    return cmd;
+}
+
+
+static minimatcmd gatherNameList(char * head, minimatcmdType operation, bool required) {
+    minimatcmd cmd = gatherUnaryOperand(head, operation);
+    char * token = strtok(NULL, " ");
+
+    // "keyword name name..." keeps the trailing names for the command
+    if( cmd.operation == CMD_ERROR || ( required && token == NULL ) ) {
+        cmd.operation = CMD_ERROR;
+        return cmd;
+    }
+
+    cmd.arguments[0] = '\0';
+
+    while( token != NULL ) {
+        strcat(cmd.arguments, token);
+        strcat(cmd.arguments, " ");
+        token = strtok(NULL, " ");
+    }
+
+    return cmd;
+}
+
+
+static minimatcmd gatherOperandPair(char * head, minimatcmdType operation) {
+    minimatcmd cmd = gatherUnaryOperand(head, operation);
+    char * token = strtok(NULL, " ");
+
+    // "keyword name name"
+    if( cmd.operation == CMD_ERROR || token == NULL || strlen(token) >= MAX_VECTOR_NAME_LEN ||
+        strtok(NULL, " ") != NULL ) {
+        cmd.operation = CMD_ERROR;
+        return cmd;
+    }
+
+    strcpy(cmd.operands[1].vecName, token);
+
+    return cmd;
+}
+
+
+/**
+ * A vector name, or a number which becomes an unnamed one element literal
+ */
+static bool parseOperand(const char * token, vector * operand) {
+
+    memset(operand, 0, sizeof(*operand));
+
+    if( token == NULL || strlen(token) >= MAX_VECTOR_NAME_LEN ) {
+        return false;
+    }
+
+    if( sscanf(token, "%lf", &operand->magnitudes[0]) == 1 ) {
+        operand->vecSize = 1;
+    } else {
+        strcpy(operand->vecName, token);
+    }
+
+    return true;
+}
+
+
+/**
+ * Splits "name[spec]" where spec is an index vector's name or up to three
+ * comma separated one-based indices
+ */
+static bool parseIndexed(char * token, vector * target, vector * idx) {
+
+    char * bracket = strchr(token, INDEX_OPEN_SYMBOL);
+    size_t length = strlen(token);
+
+    if( bracket == NULL || bracket == token || token[length - 1] != INDEX_CLOSE_SYMBOL ) {
+        return false;
+    }
+
+    *bracket = '\0';
+    token[length - 1] = '\0';
+    char * spec = bracket + 1;
+
+    memset(idx, 0, sizeof(*idx));
+    memset(target, 0, sizeof(*target));
+
+    if( strlen(token) >= MAX_VECTOR_NAME_LEN || strlen(spec) >= MAX_VECTOR_NAME_LEN || *spec == '\0' ) {
+        return false;
+    }
+
+    strcpy(target->vecName, token);
+
+    if( ! isdigit((unsigned char) *spec) ) {
+        strcpy(idx->vecName, spec);
+        return true;
+    }
+
+    for(char * index = strtok(spec, ","); index != NULL; index = strtok(NULL, ",")) {
+        if( idx->vecSize == MAX_VECTOR_DIMENSION ||
+            sscanf(index, "%lf", &idx->magnitudes[idx->vecSize]) != 1 ) {
+            return false;
+        }
+
+        ++idx->vecSize;
+    }
+
+    return true;
+}
+
+
+/**
+ * "a[idx]" gathers, "a[idx] = b" scatters b (a vector or one number) into a
+ */
+static minimatcmd gatherIndexed(char * head) {
+    minimatcmd cmd = { .operation = CMD_ERROR };
+
+    char * token = strtok(head, " ");
+    char * equals = strtok(NULL, " ");
+    char * source = strtok(NULL, " ");
+
+    if( ! parseIndexed(token, &cmd.operands[0], &cmd.operands[1]) ) {
+        return cmd;
+    }
+
+    if( equals == NULL ) {
+        cmd.operation = GATHER;
+        return cmd;
+    }
+
+    vector literal;
+
+    if( strcmp(equals, "=") != 0 || ! parseOperand(source, &literal) || strtok(NULL, " ") != NULL ) {
+        return cmd;
+    }
+
+    strcpy(cmd.arguments, source);
+    cmd.operation = SCATTER;
+
+    return cmd;
+}
+
+
+/**
+ * "keyword mask a [b]" keeps the mask name in the arguments and the
+ * operands, names or numbers, in the operands
+ */
+static minimatcmd gatherMasked(char * head, minimatcmdType operation, int numOperands) {
+    minimatcmd cmd = { .operation = CMD_ERROR };
+
+    strtok(head, " "); // Parse keyword
+    char * mask = strtok(NULL, " ");
+
+    if( mask == NULL || strlen(mask) >= MAX_VECTOR_NAME_LEN ) {
+        return cmd;
+    }
+
+    for(int i = 0; i < numOperands; ++i) {
+        if( ! parseOperand(strtok(NULL, " "), &cmd.operands[i]) ) {
+            return cmd;
+        }
+    }
+
+    if( strtok(NULL, " ") != NULL ) {
+        return cmd;
+    }
+
+    strcpy(cmd.arguments, mask);
+    cmd.operation = operation;
+
+    return cmd;
+}
+
+
+static bool isCompoundAssignment(const char * symbol) {
+    return strcmp(symbol, ADD_ASSIGN_SYMBOL) == 0 || strcmp(symbol, SUB_ASSIGN_SYMBOL) == 0 ||
+           strcmp(symbol, SCALE_ASSIGN_SYMBOL) == 0;
+}
+
+
+/**
+ * "a += b", "a -= b", "a *= s" and "a += s*b" update a where it is stored.
+ * The multiplier of b, including the sign for -=, goes in the scalar.
+ */
+static minimatcmd gatherCompoundAssignment(char * head) {
+    minimatcmd cmd = { .operation = CMD_ERROR };
+
+    char * name = strtok(head, " ");
+    char * symbol = strtok(NULL, " ");
+    char * rest = strtok(NULL, "");
+
+    if( name == NULL || symbol == NULL || rest == NULL || strlen(name) >= MAX_VECTOR_NAME_LEN ) {
+        return cmd;
+    }
+
+    // "2 * b" and "2*b" read the same
+    char term[INPUT_BUFFER_SIZE];
+    int length = 0;
+
+    for(char * c = rest; *c != '\0'; ++c) {
+        if( ! isspace((unsigned char) *c) ) {
+            term[length++] = *c;
+        }
+    }
+
+    term[length] = '\0';
+
+    char extra;
+    strcpy(cmd.operands[0].vecName, name);
+
+    if( strcmp(symbol, SCALE_ASSIGN_SYMBOL) == 0 ) {
+        if( sscanf(term, "%lf%c", &cmd.scalar, &extra) == 1 ) {
+            cmd.operation = SCALE_ASSIGN;
+        }
+        return cmd;
+    }
+
+    bool adding = ( strcmp(symbol, ADD_ASSIGN_SYMBOL) == 0 );
+    minimatcmdType operation = adding ? ADD_ASSIGN : SUB_ASSIGN;
+    double multiplier = 1.0;
+    char * operand = term;
+    char * product = strchr(term, SCALARMUL_SYMBOL);
+
+    if( product != NULL ) {
+        *product = '\0';
+        operand = product + 1;
+        operation = AXPY;
+
+        if( sscanf(term, "%lf%c", &multiplier, &extra) != 1 ) {
+            return cmd;
+        }
+    }
+
+    if( *operand == '\0' || ! parseOperand(operand, &cmd.operands[1]) ) {
+        return cmd;
+    }
+
+    cmd.scalar = adding ? multiplier : -multiplier;
+    cmd.operation = operation;
+
+    return cmd;
+}
+
+
+static minimatcmd parseCmd(char * cmdInput) {
+
+    minimatcmd cmd = { .operation = CMD_ERROR };
+
+    // Indexing, read before '=' since a scatter is written as an assignment
+    char first[INPUT_BUFFER_SIZE];
+    if( sscanf(cmdInput, "%s", first) == 1 && strchr(first, INDEX_OPEN_SYMBOL) != NULL ) {
+        return gatherIndexed(cmdInput);
+    }
+
+    // In-place updates, checked before '=' which they also contain
+    char assignment[INPUT_BUFFER_SIZE];
+    if( sscanf(cmdInput, "%*s %s", assignment) == 1 && isCompoundAssignment(assignment) ) {
+        return gatherCompoundAssignment(cmdInput);
+    }
 
     // Vector creation
     char *equal_sign = strchr(cmdInput, DATA_CREATE_SYMBOL);
     if( equal_sign != NULL ) {
-        cmd.operands[0] = createVectorFromConsole(cmdInput);
-        cmd.operation = DATA_CREATE;
-        return cmd;
+        return createVectorFromConsole(cmdInput);
+    }
+
+    // Keyword commands, checked before the operator symbols since the
+    // keywords themselves may contain them
+    char keyword[INPUT_BUFFER_SIZE];
+    if( sscanf(cmdInput, "%s", keyword) == 1 ) {
+        for(size_t i = 0; i < NUM_UNARY_KEYWORDS; ++i) {
+            if( strcmp(keyword, unaryKeywords[i].keyword) == 0 ) {
+                return gatherUnaryOperand(cmdInput, unaryKeywords[i].operation);
+            }
+        }
+
+        for(size_t i = 0; i < NUM_NUMERIC_KEYWORDS; ++i) {
+            if( strcmp(keyword, numericKeywords[i].keyword) == 0 ) {
+                return gatherNumericArguments(cmdInput, numericKeywords[i].operation,
+                                              numericKeywords[i].numArguments);
+            }
+        }
+
+        if( strcmp(keyword, MAP_KEYWORD) == 0 ) {
+            return gatherFileOperand(cmdInput, MAP_FILE);
+        }
+
+        if( strcmp(keyword, MATERIALIZE_KEYWORD) == 0 ) {
+            return gatherUnaryOperand(cmdInput, MATERIALIZE);
+        }
+
+        if( strcmp(keyword, MATRIX_KEYWORD) == 0 ) {
+            return gatherNameList(cmdInput, MATRIX_CREATE, true);
+        }
+
+        if( strcmp(keyword, STREAM_KEYWORD) == 0 ) {
+            return gatherNameList(cmdInput, STREAM_OPEN, true);
+        }
+
+        if( strcmp(keyword, PAIRWISE_KEYWORD) == 0 ) {
+            return gatherNameList(cmdInput, PAIRWISE, false);
+        }
+
+        if( strcmp(keyword, KMEANS_KEYWORD) == 0 ) {
+            return gatherNameList(cmdInput, KMEANS, false);
+        }
+
+        if( strcmp(keyword, SOLVE_KEYWORD) == 0 ) {
+            return gatherOperandPair(cmdInput, SOLVE);
+        }
+
+        if( strcmp(keyword, CACHE_KEYWORD) == 0 ) {
+            if( strcmp(cmdInput, CACHE_KEYWORD) == 0 ) {
+                cmd.operation = CACHE_STATS;
+                return cmd;
+            }
+
+            return gatherNumericArguments(cmdInput, SET_CACHE_BUDGET, 1);
+        }
+
+        // "compress on|off" is the setting, "compress mask a" the operation
+        if( strcmp(keyword, COMPRESS_KEYWORD) == 0 ) {
+            char setting[INPUT_BUFFER_SIZE];
+            char extra[INPUT_BUFFER_SIZE];
+
+            if( sscanf(cmdInput, "%*s %s %s", setting, extra) == 1 ) {
+                return gatherSetting(cmdInput, SET_COMPRESS);
+            }
+
+            return gatherMasked(cmdInput, COMPRESS_MASKED, 1);
+        }
+
+        if( strcmp(keyword, WHERE_KEYWORD) == 0 ) {
+            return gatherMasked(cmdInput, WHERE, 2);
+        }
+
+        if( strcmp(keyword, SELECT_KEYWORD) == 0 ) {
+            return gatherMasked(cmdInput, SELECT, 1);
+        }
+
+        if( strcmp(keyword, JOBS_KEYWORD) == 0 ) {
+            return gatherNumericArguments(cmdInput, LIST_JOBS, 0);
+        }
+
+        // "wait" alone waits for every job
+        if( strcmp(keyword, WAIT_KEYWORD) == 0 ) {
+            if( strcmp(cmdInput, WAIT_KEYWORD) == 0 ) {
+                cmd.operation = WAIT_JOB;
+                return cmd;
+            }
+
+            return gatherNumericArguments(cmdInput, WAIT_JOB, 1);
+        }
+
+        if( strcmp(keyword, JIT_KEYWORD) == 0 ) {
+            return gatherSetting(cmdInput, SET_JIT);
+        }
+
+        if( strcmp(keyword, FASTMATH_KEYWORD) == 0 ) {
+            return gatherSetting(cmdInput, SET_FASTMATH);
+        }
+
+        if( strcmp(keyword, PROFILE_KEYWORD) == 0 ) {
+            return gatherSetting(cmdInput, SET_PROFILE);
+        }
+    }
+
+    // Binary operations are "operand symbol operand", so dispatch on the
+    // symbol token rather than any matching character (e.g. "a * -2")
+    char operand[INPUT_BUFFER_SIZE];
+    char symbol[INPUT_BUFFER_SIZE];
+    char opSymbol = '\0';
+
+    if( sscanf(cmdInput, "%s %s", operand, symbol) == 2 && strlen(symbol) == 1 ) {
+        opSymbol = symbol[0];
     }
 
     // Vector addition
-    char *add_sign = strchr(cmdInput, ADD_SYMBOL);
-    if( add_sign != NULL ) {
+    if( opSymbol == ADD_SYMBOL ) {
         cmd = gatherOperandsOperation(cmdInput, ADD_SYMBOL);
-        cmd.operation = ADD;
+        if( cmd.operation != CMD_ERROR ) {
+            cmd.operation = ADD;
+        }
         return cmd;
     }
 
     // Vector subtraction
-    char *sub_sign = strchr(cmdInput, SUB_SYMBOL);
-    if( sub_sign != NULL ) {
+    if( opSymbol == SUB_SYMBOL ) {
         cmd = gatherOperandsOperation(cmdInput, SUB_SYMBOL);
-        cmd.operation = SUB;
+        if( cmd.operation != CMD_ERROR ) {
+            cmd.operation = SUB;
+        }
         return cmd;
     }
 
     // Vector multiplication
-    char *mul_sign = strchr(cmdInput, DOTPROD_SYMBOL);
-    if( mul_sign != NULL ) {
+    if( opSymbol == DOTPROD_SYMBOL ) {
         cmd = gatherOperandsOperation(cmdInput, DOTPROD_SYMBOL);
         return cmd;
     }
 
     // Vector cross product
-    char * crossprod_sign = strchr(cmdInput, XPROD_SYMBOL);
-    if( crossprod_sign != NULL ) {
+    if( opSymbol == XPROD_SYMBOL ) {
         cmd = gatherOperandsOperation(cmdInput, XPROD_SYMBOL);
-        cmd.operation = XPROD;
+        if( cmd.operation != CMD_ERROR ) {
+            cmd.operation = XPROD;
+        }
+        return cmd;
+    }
+
+    // Comparison masks, against a vector or a number
+    if( opSymbol == GREATER_SYMBOL || opSymbol == LESS_SYMBOL ) {
+        cmd = gatherOperandsOperation(cmdInput, opSymbol);
+        if( cmd.operation != CMD_ERROR ) {
+            char rhs[MAX_VECTOR_NAME_LEN];
+            strcpy(rhs, cmd.operands[1].vecName);
+            parseOperand(rhs, &cmd.operands[1]);
+            cmd.operation = ( opSymbol == GREATER_SYMBOL ) ? GREATER : LESS;
+        }
+        return cmd;
+    }
+
+    // List the workspace
+    if( strcmp(cmdInput, WHOS_KEYWORD) == 0 ) {
+        cmd.operation = WHOS;
         return cmd;
     }
 
@@ -153,58 +719,463 @@ static minimatcmd minimatProcessCmd( char * cmdInput ) {
 }
 
 
-static void minimatExecuteCmd( minimatcmd cmd ) {
+minimatcmd minimatProcessCmd( char * cmdInput ) {
+
+    // A trailing "&" runs the command as a background job
+    size_t length = strlen(cmdInput);
+
+    while( length > 0 && isspace((unsigned char) cmdInput[length - 1]) ) {
+        --length;
+    }
+
+    bool background = ( length > 0 && cmdInput[length - 1] == BACKGROUND_SYMBOL );
+
+    if( background ) {
+        do {
+            cmdInput[--length] = '\0';
+        } while( length > 0 && isspace((unsigned char) cmdInput[length - 1]) );
+    }
+
+    minimatcmd cmd = parseCmd(cmdInput);
+    cmd.background = background;
+
+    return cmd;
+}
+
+
+static vector namedOperand(const char * name) {
+
+    vector operand = { .vecSize = 0 };
+    strcpy(operand.vecName, name);
+
+    return operand;
+}
+
 
-    volatile vector ans; // result vector
+static bool evaluateCmd( minimatcmd cmd, vector * ans ) {
 
     // based on the operation of the command call the function
+    switch(cmd.operation) {
+
+        case ADD:
+            *ans = add(cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case SUB:
+            *ans = sub(cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case DOTPROD:
+            *ans = dotprod(cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case SCALARMUL:
+            *ans = scalarmul(cmd.operands[0], cmd.scalar);
+            break;
+
+        case XPROD:
+            *ans = xprod(cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case SORT:
+            *ans = sort(cmd.operands[0]);
+            break;
+
+        case ARGSORT:
+            *ans = argsort(cmd.operands[0]);
+            break;
+
+        case CUMSUM:
+            *ans = cumsum(cmd.operands[0]);
+            break;
+
+        case CUMPROD:
+            *ans = cumprod(cmd.operands[0]);
+            break;
+
+        case SQRT:
+            *ans = elementwise(cmd.operands[0], sqrt);
+            break;
+
+        case EXP:
+            *ans = elementwise(cmd.operands[0], exp);
+            break;
+
+        case LOG:
+            *ans = elementwise(cmd.operands[0], log);
+            break;
+
+        case SIN:
+            *ans = elementwise(cmd.operands[0], sin);
+            break;
+
+        case COS:
+            *ans = elementwise(cmd.operands[0], cos);
+            break;
+
+        case TANH:
+            *ans = elementwise(cmd.operands[0], tanh);
+            break;
+
+        case ABS:
+            *ans = elementwise(cmd.operands[0], fabs);
+            break;
+
+        case GREATER:
+            *ans = compare(cmd.operands[0], cmd.operands[1], GREATER_SYMBOL);
+            break;
+
+        case LESS:
+            *ans = compare(cmd.operands[0], cmd.operands[1], LESS_SYMBOL);
+            break;
+
+        case WHERE:
+            *ans = where(namedOperand(cmd.arguments), cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case SELECT:
+            *ans = selectWhere(namedOperand(cmd.arguments), cmd.operands[0]);
+            break;
+
+        case COMPRESS_MASKED:
+            *ans = compressWhere(namedOperand(cmd.arguments), cmd.operands[0]);
+            break;
+
+        case GATHER:
+            *ans = gather(cmd.operands[0], cmd.operands[1]);
+            break;
+
+        case SCATTER: {
+            vector source;
+            parseOperand(cmd.arguments, &source);
+            *ans = scatter(cmd.operands[0], cmd.operands[1], source);
+            break;
+        }
+
+        case RAND:
+            *ans = randu(cmd.operands[0].magnitudes[0]);
+            break;
+
+        case RANDN:
+            *ans = randn(cmd.operands[0].magnitudes[0]);
+            break;
+
+        case RANDI:
+            *ans = randi(cmd.operands[0].magnitudes[0], cmd.operands[0].magnitudes[1],
+                         cmd.operands[0].magnitudes[2]);
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+
+bool minimatEvaluateCmd( minimatcmd cmd, vector * ans ) {
+
+    memoKey key;
+    bool memoizable = memoKeyFor(&cmd, &key);
+
+    if( memoizable && memoLookup(&key, ans) ) {
+        return true;
+    }
+
+    if( ! evaluateCmd(cmd, ans) ) {
+        return false;
+    }
+
+    // Failures are left uncached so they report themselves every time
+    if( memoizable && ! FAILED_RESULT(*ans) ) {
+        memoStore(&key, ans);
+    }
+
+    return true;
+}
+
+
+bool minimatCommitResult( vector ans ) {
+
+    // The operation already reported why it failed
+    if( FAILED_RESULT(ans) ) {
+        return false;
+    }
+
+    unmapVector(ans.vecName);
+    addVectorToMemoryList(ans);
+    printVector(ans);
+
+    return true;
+}
+
+
+/**
+ * Streams and vectors share one set of names, a vector can't take a
+ * stream's name
+ */
+static bool createsOverStream(minimatcmd cmd) {
+
+    bool creates = ( cmd.operation == DATA_CREATE || cmd.operation == DATA_COPY ||
+                     cmd.operation == MAP_FILE || cmd.operation == GENERATOR_CREATE );
+
+    if( creates && isStream(cmd.operands[0].vecName) ) {
+        printMessage(ANSI_COLOR_RED "ERROR: That name belongs to a stream" ANSI_COLOR_RESET);
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * ... and a stream can't take a vector's name. ans counts as taken, the
+ * next result is stored there
+ */
+static bool nameIsVector(const char * name) {
+
+    vectorHandle handle;
+
+    if( strcmp(name, "ans") == 0 || findVector(name, &handle) || isMappedVector(name) ) {
+        printMessage(ANSI_COLOR_RED "ERROR: That name belongs to a vector" ANSI_COLOR_RESET);
+        return true;
+    }
+
+    return false;
+}
+
+
+static bool executeCmd( minimatcmd cmd ) {
+
+    vector ans; // result vector
+
+    if( createsOverStream(cmd) ) {
+        return false;
+    }
+
+    // Operations on file-backed vectors stream through the files instead
+    if( involvesMappedVectors(cmd) ) {
+        return executeMappedCmd(cmd);
+    }
+
     switch(cmd.operation) {
 
         case DATA_CREATE:
+            unmapVector(cmd.operands[0].vecName);
             addVectorToMemoryList(cmd.operands[0]);
             printVector(cmd.operands[0]);
             break;
 
-        case ADD:
-            ans = add(cmd.operands[0], cmd.operands[1]);
-            addVectorToMemoryList(ans);
-            printVector(ans);
+        case DATA_COPY:
+            ans = cmd.operands[1];
+
+            if( ! grabVector(&ans) ) {
+                printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+                return false;
+            }
+
+            // assign properties of vector to result (copy all but name)
+            copyVectorKeepName(&ans, &cmd.operands[0]);
+
+            unmapVector(cmd.operands[0].vecName);
+            addVectorToMemoryList(cmd.operands[0]);
+            printVector(cmd.operands[0]);
             break;
 
-        case SUB:
-            ans = sub(cmd.operands[0], cmd.operands[1]);
-            addVectorToMemoryList(ans);
+        case ADD_ASSIGN:
+        case SUB_ASSIGN:
+        case AXPY:
+            ans = axpyInPlace(cmd.operands[0].vecName, cmd.scalar, cmd.operands[1]);
+
+            if( FAILED_RESULT(ans) ) {
+                return false;
+            }
+
             printVector(ans);
             break;
 
-        case DOTPROD:
-            ans = dotprod(cmd.operands[0], cmd.operands[1]);
-            addVectorToMemoryList(ans);
+        case SCALE_ASSIGN:
+            ans = scaleInPlace(cmd.operands[0].vecName, cmd.scalar);
+
+            if( FAILED_RESULT(ans) ) {
+                return false;
+            }
+
             printVector(ans);
             break;
 
-        case SCALARMUL:
-            ans = scalarmul(cmd.operands[0], cmd.scalar);
-            addVectorToMemoryList(ans);
-            printVector(ans);
+        case MAP_FILE:
+            if( ! mapVectorFile(cmd.operands[0].vecName, cmd.arguments) ) {
+                return false;
+            }
+
+            printMessage(ANSI_COLOR_GREEN "Vector mapped to file" ANSI_COLOR_RESET);
             break;
 
-        case XPROD:
-            ans = xprod(cmd.operands[0], cmd.operands[1]);
-            addVectorToMemoryList(ans);
-            printVector(ans);
+        case GENERATOR_CREATE:
+            return defineGenerator(cmd.operands[0].vecName, cmd.arguments,
+                                   cmd.operands[1].magnitudes, cmd.operands[1].vecSize);
+
+        case MATERIALIZE:
+            return materializeVector(cmd.operands[0].vecName);
+
+        case STREAM_OPEN:
+            return ! nameIsVector(cmd.operands[0].vecName) &&
+                   openStream(cmd.operands[0].vecName, cmd.arguments);
+
+        case STREAM_STATS:
+            return printStreamStats(cmd.operands[0].vecName);
+
+        case MATRIX_CREATE:
+            if( ! createMatrix(cmd.operands[0].vecName, cmd.arguments) ) {
+                return false;
+            }
             break;
 
+        case SOLVE:
+            return minimatCommitResult(solve(cmd.operands[0].vecName, cmd.operands[1]));
+
+        case CHOL:
+            return chol(cmd.operands[0].vecName);
+
+        case PAIRWISE:
+            return pairwise(cmd.operands[0].vecName, cmd.arguments);
+
+        case KMEANS:
+            return kmeans(cmd.operands[0].vecName, cmd.arguments);
+
         case CLEAR:
+            clearMatrices();
+            closeStreams();
+            unmapVectors();
             clearVectors();
-            puts(ANSI_COLOR_GREEN "Vector memory has been cleared" ANSI_COLOR_RESET);
+            printMessage(ANSI_COLOR_GREEN "Vector memory has been cleared" ANSI_COLOR_RESET);
             break;
 
-        default:
-            puts(ANSI_COLOR_RED "ERROR: That command is not supported" ANSI_COLOR_RESET);
+        case SEED:
+            // Checked before the cast, converting a value out of range is undefined
+            if( ! ( cmd.operands[0].magnitudes[0] >= 0 && cmd.operands[0].magnitudes[0] < 18446744073709551616.0 ) ) {
+                printMessage(ANSI_COLOR_RED "ERROR: The seed must be a non-negative number" ANSI_COLOR_RESET);
+                return false;
+            }
+
+            seedRandom((uint64_t) cmd.operands[0].magnitudes[0]);
+            printMessage(ANSI_COLOR_GREEN "Random generator seeded" ANSI_COLOR_RESET);
+            break;
+
+        case CACHE_STATS:
+            printMemoStats();
+            break;
+
+        case LIST_JOBS:
+            listJobs();
             break;
+
+        case WAIT_JOB:
+            return waitJob((int) cmd.operands[0].magnitudes[0]);
+
+        case SET_COMPRESS:
+            setCompressCold(cmd.scalar != 0);
+
+            if( cmd.scalar != 0 ) {
+                printMessage(ANSI_COLOR_GREEN "Cold file-backed vectors will be compressed" ANSI_COLOR_RESET);
+            } else {
+                printMessage(ANSI_COLOR_GREEN "Cold vector compression disabled" ANSI_COLOR_RESET);
+            }
+            break;
+
+        case SET_FASTMATH:
+            setFastMath(cmd.scalar != 0);
+
+            if( cmd.scalar != 0 ) {
+                printMessage(ANSI_COLOR_GREEN "Mapped vectors use the fast math functions" ANSI_COLOR_RESET);
+            } else {
+                printMessage(ANSI_COLOR_GREEN "Mapped vectors use libm's math functions" ANSI_COLOR_RESET);
+            }
+            break;
+
+        case WHOS:
+            printMessage(ANSI_COLOR_BLUE "\tname                 elements  storage           bytes    ratio   decode" ANSI_COLOR_RESET);
+            printStoredVectors();
+            printMappedVectors();
+            break;
+
+        case SET_CACHE_BUDGET:
+            if( cmd.operands[0].magnitudes[0] < 0 ) {
+                printMessage(ANSI_COLOR_RED "ERROR: The cache budget can't be negative" ANSI_COLOR_RESET);
+                return false;
+            }
+
+            setMemoBudget((size_t) cmd.operands[0].magnitudes[0]);
+            printMessage(ANSI_COLOR_GREEN "Cache budget set" ANSI_COLOR_RESET);
+            break;
+
+        case SET_PROFILE:
+            if( cmd.scalar == 0 ) {
+                if( profilingEnabled() ) {
+                    printProfile();
+                    stopProfiling();
+                }
+            } else if( startProfiling() ) {
+                printMessage(ANSI_COLOR_GREEN "Profiling with hardware counters" ANSI_COLOR_RESET);
+            } else {
+                printMessage(ANSI_COLOR_YELLOW "Hardware counters unavailable, profiling wall time only" ANSI_COLOR_RESET);
+            }
+            break;
+
+        case SET_JIT:
+            setJitEnabled(cmd.scalar != 0);
+
+            if( jitEnabled() ) {
+                printMessage(ANSI_COLOR_GREEN "JIT compilation enabled" ANSI_COLOR_RESET);
+            } else if( cmd.scalar != 0 ) {
+                printMessage(ANSI_COLOR_YELLOW "JIT not supported here, using the C loops" ANSI_COLOR_RESET);
+            } else {
+                printMessage(ANSI_COLOR_GREEN "JIT compilation disabled" ANSI_COLOR_RESET);
+            }
+            break;
+
+        default:
+            if( ! minimatEvaluateCmd(cmd, &ans) ) {
+                printMessage(ANSI_COLOR_RED "ERROR: That command is not supported" ANSI_COLOR_RESET);
+                return false;
+            }
+
+            return minimatCommitResult(ans);
+    }
+
+    return true;
+}
+
+
+bool minimatExecuteCmd( minimatcmd cmd ) {
+
+    bool executed;
+
+    // Store finished jobs, waiting on any this command depends on
+    settleJobs(cmd);
+
+    bool background = cmd.background && canRunInBackground(cmd);
+
+    if( cmd.background && ! background ) {
+        printMessage(ANSI_COLOR_YELLOW "That command can't run in the background, running it now" ANSI_COLOR_RESET);
+    }
+
+    // Switching profiling is not itself part of the profile
+    if( background ) {
+        executed = submitJob(cmd);
+    } else if( ! profilingEnabled() || cmd.operation == SET_PROFILE ) {
+        executed = executeCmd(cmd);
+    } else {
+        profileBegin();
+        executed = executeCmd(cmd);
+        profileEnd(cmd.operation);
     }
 
+    // Age the file-backed vectors, packing any that have gone cold
+    compressColdVectors();
+
+    return executed;
 }
 
 
@@ -212,17 +1183,34 @@ bool minimatExecutionLoop( void ) {
     
     char inputBuffer[INPUT_BUFFER_SIZE];
 
-    // grab entire line of input from console
-    fgets(inputBuffer, sizeof(inputBuffer), stdin);
+    // grab entire line of input from console, end of input exits too,
+    // after the background jobs have finished
+    if( fgets(inputBuffer, sizeof(inputBuffer), stdin) == NULL ) {
+        waitJob(0);
+        return false;
+    }
 
     // remove trailing newline character to prevent bugs
     inputBuffer[strcspn(inputBuffer, "\n")] = '\0';
 
     // if exit command issued then exit control loop
     if( strcmp(inputBuffer, EXIT_SYMBOL) == 0 ) {
+        waitJob(0);
         return false;
     }
 
+    // Blocks read their body up to the matching end before running
+    if( isBlockStart(inputBuffer) ) {
+        scriptBlock * block = compileBlock(inputBuffer, stdin);
+
+        if( block != NULL ) {
+            runBlock(block);
+            freeBlock(block);
+        }
+
+        return true;
+    }
+
     // get command details from console input
     minimatcmd cmd = minimatProcessCmd(&inputBuffer[0]);
 
@@ -231,13 +1219,3 @@ bool minimatExecutionLoop( void ) {
 
     return true;
 }
-
-
-int main ( void ) {
-
-    while ( minimatExecutionLoop() ) { /* Nothing here */ }
-    
-    puts(ANSI_COLOR_CYAN "Exiting..." ANSI_COLOR_RESET);
-
-    return 0;
-}
\ No newline at end of file
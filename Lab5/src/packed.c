@@ -0,0 +1,116 @@
+/**
+ * @file packed.c
+ * @brief Copies stored vectors into contiguous per-coordinate arrays for
+ * the commands that work over many of them at once
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Read "name name... [> path]", or every stored vector if no names
+ *  - Check they all share one dimension and copy their coordinates out
+ */
+
+#include "packed.h"
+#include "termcolors.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static bool packVector(packedVectors * packed, const vector * v) {
+
+    if( packed->count == 0 ) {
+        packed->dims = v->vecSize;
+    } else if( v->vecSize != packed->dims ) {
+        printMessage(ANSI_COLOR_RED "Vectors must have the same dimension" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    for(int d = 0; d < packed->dims; ++d) {
+        packed->coords[d][packed->count] = v->magnitudes[d];
+    }
+
+    strcpy(packed->names[packed->count++], v->vecName);
+
+    return true;
+}
+
+
+bool packVectors( packedVectors * packed, char * names, const char ** path ) {
+
+    int capacity = numStoredVectors();
+    bool allocated = true;
+
+    memset(packed, 0, sizeof(*packed));
+
+    for(int d = 0; d < MAX_VECTOR_DIMENSION; ++d) {
+        packed->coords[d] = malloc(( capacity + 1 ) * sizeof(double));
+        allocated = allocated && packed->coords[d] != NULL;
+    }
+
+    packed->names = malloc(( capacity + 1 ) * sizeof(*packed->names));
+
+    if( ! allocated || packed->names == NULL ) {
+        printMessage(ANSI_COLOR_RED "Not enough memory for that many vectors" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    bool named = false;
+    *path = NULL;
+
+    for(char * token = strtok(names, " "); token != NULL; token = strtok(NULL, " ")) {
+
+        if( strcmp(token, PACKED_FILE_SYMBOL) == 0 ) {
+            *path = strtok(NULL, " ");
+
+            if( *path == NULL || strtok(NULL, " ") != NULL ) {
+                printMessage(ANSI_COLOR_RED "ERROR: Expected a single path after >" ANSI_COLOR_RESET);
+                return false;
+            }
+            break;
+        }
+
+        vectorHandle handle;
+        named = true;
+
+        // A name listed twice would need more room than the store has
+        if( packed->count == capacity ) {
+            printMessage(ANSI_COLOR_RED "ERROR: Too many names given" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        if( ! findVector(token, &handle) ) {
+            printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        if( ! packVector(packed, vectorFromHandle(handle)) ) {
+            return false;
+        }
+    }
+
+    for(int i = 0; ! named && i < capacity; ++i) {
+        if( ! packVector(packed, storedVectorAt(i)) ) {
+            return false;
+        }
+    }
+
+    if( packed->count == 0 ) {
+        printMessage(ANSI_COLOR_RED "There are no vectors to work on" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    return true;
+}
+
+
+void freePackedVectors( packedVectors * packed ) {
+
+    for(int d = 0; d < MAX_VECTOR_DIMENSION; ++d) {
+        free(packed->coords[d]);
+    }
+
+    free(packed->names);
+}
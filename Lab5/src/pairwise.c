@@ -0,0 +1,306 @@
+/**
+ * @file pairwise.c
+ * @brief All-pairs distances and Gram matrices over stored vectors
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - "pairwise metric [names...] [> path]" packs the named vectors, or
+ *    every stored vector, into one array per coordinate (packed.c)
+ *  - The result is symmetric, so only the upper triangle is computed
+ *    and stored, in PAIRWISE_BLOCK x PAIRWISE_BLOCK tiles
+ *  - Large inputs hand out row blocks to threads, each row block
+ *    covers its tiles from the diagonal to the right edge
+ *  - Small results print as a matrix, large ones go to the file
+ */
+
+#include "pairwise.h"
+#include "packed.h"
+#include "termcolors.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Room for a message naming the output file
+#define PAIRWISE_LINE_LEN 160
+
+typedef enum {
+
+    METRIC_L2,
+    METRIC_COSINE,
+    METRIC_GRAM
+
+} pairwiseMetric;
+
+typedef struct {
+
+    pairwiseMetric metric;
+    int count; // number of vectors
+    int dims; // shared dimension
+    double * const * coords; // coords[d][i], one array per coordinate
+    double * norms; // for cosine
+    double * result; // packed upper triangle, row by row
+    int numBlocks;
+    int nextBlock; // next row block to hand out, taken atomically
+
+} pairwiseJob;
+
+
+static size_t triangleIndex(int n, int row, int col) {
+    return (size_t) row * n - (size_t) row * ( row - 1 ) / 2 + ( col - row );
+}
+
+
+static double resultAt(const pairwiseJob * job, int row, int col) {
+    return ( row <= col ) ? job->result[triangleIndex(job->count, row, col)]
+                          : job->result[triangleIndex(job->count, col, row)];
+}
+
+
+/**
+ * Fills the part of one tile on or above the diagonal
+ */
+static void computeTile(pairwiseJob * job, int rowBlock, int colBlock) {
+
+    int n = job->count;
+    int rowEnd = ( rowBlock + 1 ) * PAIRWISE_BLOCK < n ? ( rowBlock + 1 ) * PAIRWISE_BLOCK : n;
+    int colStart = colBlock * PAIRWISE_BLOCK;
+    int colEnd = colStart + PAIRWISE_BLOCK < n ? colStart + PAIRWISE_BLOCK : n;
+
+    for(int i = rowBlock * PAIRWISE_BLOCK; i < rowEnd; ++i) {
+        int jStart = ( i > colStart ) ? i : colStart;
+        double * out = &job->result[triangleIndex(n, i, jStart)];
+
+        double row[MAX_VECTOR_DIMENSION];
+        for(int d = 0; d < job->dims; ++d) {
+            row[d] = job->coords[d][i];
+        }
+
+        // One loop per metric keeps the inner loop free of branches
+        switch(job->metric) {
+
+            case METRIC_L2:
+                for(int j = jStart; j < colEnd; ++j) {
+                    double sum = 0.0;
+                    for(int d = 0; d < job->dims; ++d) {
+                        double diff = row[d] - job->coords[d][j];
+                        sum += diff * diff;
+                    }
+                    *out++ = sqrt(sum);
+                }
+                break;
+
+            case METRIC_COSINE:
+                for(int j = jStart; j < colEnd; ++j) {
+                    double dot = 0.0;
+                    for(int d = 0; d < job->dims; ++d) {
+                        dot += row[d] * job->coords[d][j];
+                    }
+                    *out++ = 1.0 - dot / ( job->norms[i] * job->norms[j] );
+                }
+                break;
+
+            case METRIC_GRAM:
+                for(int j = jStart; j < colEnd; ++j) {
+                    double dot = 0.0;
+                    for(int d = 0; d < job->dims; ++d) {
+                        dot += row[d] * job->coords[d][j];
+                    }
+                    *out++ = dot;
+                }
+                break;
+        }
+    }
+}
+
+
+static void * pairwiseWorker(void * arg) {
+
+    pairwiseJob * job = arg;
+    int rowBlock;
+
+    // Earlier row blocks have more tiles, so handing them out in order
+    // lets the short ones at the end fill in the gaps
+    while( ( rowBlock = __atomic_fetch_add(&job->nextBlock, 1, __ATOMIC_RELAXED) ) < job->numBlocks ) {
+        for(int colBlock = rowBlock; colBlock < job->numBlocks; ++colBlock) {
+            computeTile(job, rowBlock, colBlock);
+        }
+    }
+
+    return NULL;
+}
+
+
+static void computeAll(pairwiseJob * job) {
+
+    job->numBlocks = ( job->count + PAIRWISE_BLOCK - 1 ) / PAIRWISE_BLOCK;
+    job->nextBlock = 0;
+
+    pthread_t threads[MAX_PAIRWISE_THREADS];
+    int numThreads = 0;
+
+    if( job->count >= PAIRWISE_PARALLEL_MIN ) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int wanted = ( cpus > MAX_PAIRWISE_THREADS ) ? MAX_PAIRWISE_THREADS : (int) cpus;
+
+        // The calling thread is one of them
+        for(int i = 1; i < wanted; ++i) {
+            if( pthread_create(&threads[numThreads], NULL, pairwiseWorker, job) == 0 ) {
+                ++numThreads;
+            }
+        }
+    }
+
+    pairwiseWorker(job);
+
+    for(int i = 0; i < numThreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+
+static bool printResult(const pairwiseJob * job, const char * metric) {
+
+    char line[PAIRWISE_LINE_LEN];
+
+    snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s =" ANSI_COLOR_RESET, metric);
+    printMessage(line);
+
+    // A row of PAIRWISE_PRINT_MAX large values is far longer than a line,
+    // so each row is built in a buffer that grows to fit
+    for(int r = 0; r < job->count; ++r) {
+        char * row = NULL;
+        size_t rowLen = 0;
+        FILE * stream = open_memstream(&row, &rowLen);
+
+        if( stream == NULL ) {
+            printMessage(ANSI_COLOR_RED "Not enough memory for pairwise" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        fputs(ANSI_COLOR_BLUE "\t\t", stream);
+
+        for(int c = 0; c < job->count; ++c) {
+            fprintf(stream, ( c == 0 ) ? "%f" : " %f", resultAt(job, r, c));
+        }
+
+        fputs(ANSI_COLOR_RESET, stream);
+        fclose(stream);
+
+        printMessage(row);
+        free(row);
+    }
+
+    return true;
+}
+
+
+static bool writeResult(const pairwiseJob * job, const char * metric, const char * path) {
+
+    FILE * out = fopen(path, "w");
+
+    if( out == NULL ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not open the output file" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    for(int r = 0; r < job->count; ++r) {
+        for(int c = 0; c < job->count; ++c) {
+            fprintf(out, ( c == 0 ) ? "%f" : " %f", resultAt(job, r, c));
+        }
+        fputc('\n', out);
+    }
+
+    if( fclose(out) != 0 ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not write the output file" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    char line[PAIRWISE_LINE_LEN];
+    snprintf(line, sizeof(line), ANSI_COLOR_GREEN "%dx%d %s matrix written to %s" ANSI_COLOR_RESET,
+             job->count, job->count, metric, path);
+    printMessage(line);
+
+    return true;
+}
+
+
+static bool computeNorms(pairwiseJob * job) {
+
+    job->norms = malloc(job->count * sizeof(double));
+
+    if( job->norms == NULL ) {
+        return false;
+    }
+
+    for(int i = 0; i < job->count; ++i) {
+        double normSquared = 0.0;
+
+        for(int d = 0; d < job->dims; ++d) {
+            normSquared += job->coords[d][i] * job->coords[d][i];
+        }
+
+        job->norms[i] = sqrt(normSquared);
+    }
+
+    return true;
+}
+
+
+bool pairwise( const char * metric, const char * args ) {
+
+    pairwiseJob job = { .count = 0 };
+    packedVectors packed;
+
+    if( strcmp(metric, PAIRWISE_L2_KEYWORD) == 0 ) {
+        job.metric = METRIC_L2;
+    } else if( strcmp(metric, PAIRWISE_COSINE_KEYWORD) == 0 ) {
+        job.metric = METRIC_COSINE;
+    } else if( strcmp(metric, PAIRWISE_GRAM_KEYWORD) == 0 ) {
+        job.metric = METRIC_GRAM;
+    } else {
+        printMessage(ANSI_COLOR_RED "ERROR: The metric must be l2, cosine or gram" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    char names[strlen(args) + 1];
+    strcpy(names, args);
+
+    const char * path = NULL;
+    bool succeeded = false;
+
+    if( packVectors(&packed, names, &path) ) {
+
+        job.count = packed.count;
+        job.dims = packed.dims;
+        job.coords = packed.coords;
+
+        size_t triangleSize = (size_t) job.count * ( job.count + 1 ) / 2;
+
+        if( path == NULL && job.count > PAIRWISE_PRINT_MAX ) {
+            printMessage(ANSI_COLOR_RED "ERROR: That result is too large to print, add > path" ANSI_COLOR_RESET);
+        } else if( ! computeNorms(&job) || ( job.result = malloc(triangleSize * sizeof(double)) ) == NULL ) {
+            printMessage(ANSI_COLOR_RED "Not enough memory for pairwise" ANSI_COLOR_RESET);
+        } else {
+            computeAll(&job);
+
+            if( path == NULL ) {
+                succeeded = printResult(&job, metric);
+            } else {
+                succeeded = writeResult(&job, metric, path);
+            }
+        }
+    }
+
+    freePackedVectors(&packed);
+    free(job.norms);
+    free(job.result);
+
+    return succeeded;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file profile.c
+ * @brief Per-command hardware counter and timing profile
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Open one perf_event group (cycles, instructions, LLC misses, branch
+ *    misses) for this thread when profiling starts
+ *  - Around each command reset and enable the group, then read all the
+ *    counters with one read and add them to the command's totals
+ *    - When the PMU is shared the group only counts part of the time it
+ *      is enabled, the counts are scaled up by enabled / running
+ *  - If the kernel refuses any of the events, only wall time is kept
+ */
+
+#include "profile.h"
+#include "minimatcmd.h"
+#include "termcolors.h"
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NANOS_PER_SECOND 1000000000LL
+#define PROFILE_LINE_LEN 160
+
+typedef struct {
+
+    uint64_t calls;
+    uint64_t nanos;
+    uint64_t counters[NUM_PROFILE_COUNTERS];
+
+} commandProfile;
+
+// Layout read() returns for a PERF_FORMAT_GROUP leader with both times
+typedef struct {
+
+    uint64_t numCounters;
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+    uint64_t values[NUM_PROFILE_COUNTERS];
+
+} groupReading;
+
+typedef struct {
+
+    uint32_t type;
+    uint64_t config;
+
+} counterEvent;
+
+// PERF_COUNT_HW_CACHE_MISSES is whichever cache the PMU driver picked,
+// the last level read misses are asked for by name
+static const counterEvent counterEvents[NUM_PROFILE_COUNTERS] = {
+    [COUNTER_CYCLES]        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [COUNTER_INSTRUCTIONS]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [COUNTER_LLC_MISSES]    = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                                                    ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                                                    ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) },
+    [COUNTER_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+static const char * commandNames[CMD_ERROR + 1] = {
+    [DATA_CREATE]      = "create",
+    [DATA_COPY]        = "copy",
+    [ADD]              = "add",
+    [SUB]              = "sub",
+    [DOTPROD]          = "dotprod",
+    [XPROD]            = "xprod",
+    [SCALARMUL]        = "scalarmul",
+    [CLEAR]            = "clear",
+    [SORT]             = "sort",
+    [ARGSORT]          = "argsort",
+    [CUMSUM]           = "cumsum",
+    [CUMPROD]          = "cumprod",
+    [SQRT]             = "sqrt",
+    [EXP]              = "exp",
+    [LOG]              = "log",
+    [SIN]              = "sin",
+    [COS]              = "cos",
+    [TANH]             = "tanh",
+    [ABS]              = "abs",
+    [RAND]             = "rand",
+    [RANDN]            = "randn",
+    [RANDI]            = "randi",
+    [SEED]             = "seed",
+    [SET_JIT]          = "jit",
+    [SET_PROFILE]      = "profile",
+    [MAP_FILE]         = "map",
+    [MATRIX_CREATE]    = "matrix",
+    [SOLVE]            = "solve",
+    [CHOL]             = "chol",
+    [CACHE_STATS]      = "cache",
+    [SET_CACHE_BUDGET] = "cache budget",
+    [PAIRWISE]         = "pairwise",
+    [KMEANS]           = "kmeans",
+    [GENERATOR_CREATE] = "generator",
+    [MATERIALIZE]      = "materialize",
+    [SET_COMPRESS]     = "compress",
+    [WHOS]             = "whos",
+    [STREAM_OPEN]      = "stream",
+    [STREAM_STATS]     = "stats",
+    [GREATER]          = "greater",
+    [LESS]             = "less",
+    [WHERE]            = "where",
+    [SELECT]           = "select",
+    [COMPRESS_MASKED]  = "compress mask",
+    [GATHER]           = "gather",
+    [SCATTER]          = "scatter",
+    [ADD_ASSIGN]       = "+=",
+    [SUB_ASSIGN]       = "-=",
+    [SCALE_ASSIGN]     = "*=",
+    [AXPY]             = "axpy",
+    [LIST_JOBS]        = "jobs",
+    [WAIT_JOB]         = "wait",
+    [SET_FASTMATH]     = "fastmath",
+    [CMD_ERROR]        = "error",
+};
+
+static commandProfile profiles[CMD_ERROR + 1];
+static int counterFds[NUM_PROFILE_COUNTERS] = { -1, -1, -1, -1 };
+static bool enabled = false;
+static bool haveCounters = false;
+static struct timespec started;
+
+
+static int openCounter(const counterEvent * event, int groupFd) {
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // This thread on any CPU
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+
+static void closeCounters( void ) {
+
+    for(int i = NUM_PROFILE_COUNTERS - 1; i >= 0; --i) {
+        if( counterFds[i] >= 0 ) {
+            close(counterFds[i]);
+            counterFds[i] = -1;
+        }
+    }
+
+    haveCounters = false;
+}
+
+
+bool startProfiling( void ) {
+
+    closeCounters();
+    memset(profiles, 0, sizeof(profiles));
+
+    haveCounters = true;
+
+    for(int i = 0; i < NUM_PROFILE_COUNTERS && haveCounters; ++i) {
+        counterFds[i] = openCounter(&counterEvents[i], ( i == 0 ) ? -1 : counterFds[0]);
+        haveCounters = counterFds[i] >= 0;
+    }
+
+    // Kernel or hardware without these events, keep timing only
+    if( ! haveCounters ) {
+        closeCounters();
+    }
+
+    enabled = true;
+
+    return haveCounters;
+}
+
+
+void stopProfiling( void ) {
+    closeCounters();
+    enabled = false;
+}
+
+
+bool profilingEnabled( void ) {
+    return enabled;
+}
+
+
+void profileBegin( void ) {
+
+    if( haveCounters ) {
+        ioctl(counterFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counterFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+}
+
+
+void profileEnd( int operation ) {
+
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    commandProfile * profile = &profiles[operation];
+
+    if( haveCounters ) {
+        ioctl(counterFds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        groupReading reading;
+
+        // A group that never got the PMU has nothing to scale
+        if( read(counterFds[0], &reading, sizeof(reading)) == sizeof(reading) && reading.timeRunning > 0 ) {
+            double scale = (double) reading.timeEnabled / reading.timeRunning;
+
+            for(int i = 0; i < NUM_PROFILE_COUNTERS; ++i) {
+                profile->counters[i] += (uint64_t) ( reading.values[i] * scale + 0.5 );
+            }
+        }
+    }
+
+    profile->nanos += ( finished.tv_sec - started.tv_sec ) * NANOS_PER_SECOND +
+                      ( finished.tv_nsec - started.tv_nsec );
+    ++profile->calls;
+}
+
+
+const char * commandName( int operation ) {
+
+    if( operation < 0 || operation > CMD_ERROR || commandNames[operation] == NULL ) {
+        return "other";
+    }
+
+    return commandNames[operation];
+}
+
+
+void printProfile( void ) {
+
+    char line[PROFILE_LINE_LEN];
+
+    if( haveCounters ) {
+        snprintf(line, sizeof(line), "\t%-10s %10s %12s %12s %12s %10s %10s", "command",
+                 "calls", "ns/call", "cycles", "instructions", "LLC-miss", "br-miss");
+    } else {
+        printMessage(ANSI_COLOR_YELLOW "Hardware counters unavailable, wall time only" ANSI_COLOR_RESET);
+        snprintf(line, sizeof(line), "\t%-10s %10s %12s", "command", "calls", "ns/call");
+    }
+
+    printMessage(line);
+
+    for(int op = 0; op <= CMD_ERROR; ++op) {
+
+        const commandProfile * profile = &profiles[op];
+
+        if( profile->calls == 0 ) {
+            continue;
+        }
+
+        const char * name = commandName(op);
+        double perCall = (double) profile->nanos / profile->calls;
+
+        if( haveCounters ) {
+            snprintf(line, sizeof(line), "\t%-10s %10llu %12.1f %12llu %12llu %10llu %10llu",
+                     name, (unsigned long long) profile->calls, perCall,
+                     (unsigned long long) profile->counters[COUNTER_CYCLES],
+                     (unsigned long long) profile->counters[COUNTER_INSTRUCTIONS],
+                     (unsigned long long) profile->counters[COUNTER_LLC_MISSES],
+                     (unsigned long long) profile->counters[COUNTER_BRANCH_MISSES]);
+        } else {
+            snprintf(line, sizeof(line), "\t%-10s %10llu %12.1f",
+                     name, (unsigned long long) profile->calls, perCall);
+        }
+
+        printMessage(line);
+    }
+}
@@ -0,0 +1,296 @@
+/**
+ * @file radix.c
+ * @brief Parallel LSD radix sort passes over windows of a file-backed vector
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Algorithm:
+ *  - Doubles are sorted on an order-preserving 64 bit key (negatives
+ *    flipped, positives sign-set), RADIX_BITS of it per pass
+ *  - One counting pass over the source histograms every digit at once
+ *  - Each sorting pass streams the input a window at a time (mapped.c)
+ *    - The window is split into parts, one per thread, and each part
+ *      counts its digits
+ *    - Parts are given their slice of every bucket in order, so equal
+ *      digits keep their order and the sort is stable
+ *    - Each part buffers RADIX_BUFFER elements per bucket and writes them
+ *      to its own slice with pwrite, no two parts ever write one byte
+ */
+
+#include "radix.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DOUBLE_SIGN_BIT 0x8000000000000000ULL
+
+typedef struct {
+
+    const radixWindow * window;
+    size_t start;
+    size_t end;
+    uint64_t counts[RADIX_PASSES][RADIX_BUCKETS];
+
+} countPart;
+
+typedef struct {
+
+    const radixWindow * window;
+    const radixPass * pass;
+    size_t start;
+    size_t end;
+    uint64_t counts[RADIX_BUCKETS];
+    uint64_t next[RADIX_BUCKETS]; // this part's slice of each bucket
+    int filled[RADIX_BUCKETS];
+    uint64_t * buffer; // RADIX_BUFFER elements per bucket
+    bool ok;
+
+} scatterPart;
+
+
+/**
+ * Maps a double onto an unsigned key whose integer order matches the
+ * numeric order of the double (negatives flipped, positives sign-set).
+ */
+uint64_t orderedKey( double d ) {
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+
+    return (bits & DOUBLE_SIGN_BIT) ? ~bits : (bits | DOUBLE_SIGN_BIT);
+}
+
+
+double keyValue( uint64_t key ) {
+
+    uint64_t bits = (key & DOUBLE_SIGN_BIT) ? (key & ~DOUBLE_SIGN_BIT) : ~key;
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+
+    return d;
+}
+
+
+static int digitOf(uint64_t key, int digit) {
+    return (int) ( ( key >> ( digit * RADIX_BITS ) ) & ( RADIX_BUCKETS - 1 ) );
+}
+
+
+static uint64_t keyAt(const radixWindow * w, bool indexed, size_t i) {
+    return ( w->values != NULL ) ? orderedKey(w->values[i]) : w->records[indexed ? 2 * i : i];
+}
+
+
+static uint64_t positionAt(const radixWindow * w, size_t i) {
+    return ( w->values != NULL ) ? w->first + i : w->records[2 * i + 1];
+}
+
+
+static int partsFor(size_t count) {
+
+    if( count < RADIX_PARALLEL_MIN ) {
+        return 1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return ( cpus > MAX_RADIX_THREADS ) ? MAX_RADIX_THREADS : ( cpus < 1 ) ? 1 : (int) cpus;
+}
+
+
+/**
+ * Runs work on every part, the calling thread takes the first and any
+ * part a thread could not be started for
+ */
+static void runParts(void * (*work)(void *), char * parts, size_t partSize, int numParts) {
+
+    pthread_t threads[MAX_RADIX_THREADS];
+    bool started[MAX_RADIX_THREADS] = { false };
+
+    for(int p = 1; p < numParts; ++p) {
+        started[p] = pthread_create(&threads[p], NULL, work, parts + p * partSize) == 0;
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        if( p == 0 || ! started[p] ) {
+            work(parts + p * partSize);
+        }
+    }
+
+    for(int p = 1; p < numParts; ++p) {
+        if( started[p] ) {
+            pthread_join(threads[p], NULL);
+        }
+    }
+}
+
+
+static void * countDigits(void * arg) {
+
+    countPart * part = arg;
+
+    for(size_t i = part->start; i < part->end; ++i) {
+        uint64_t key = orderedKey(part->window->values[i]);
+
+        for(int d = 0; d < RADIX_PASSES; ++d) {
+            ++part->counts[d][digitOf(key, d)];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Adds the digit counts of a window of source doubles to counts
+ */
+bool radixCount( const radixWindow * window, uint64_t counts[RADIX_PASSES][RADIX_BUCKETS] ) {
+
+    int numParts = partsFor(window->count);
+    countPart * parts = calloc(numParts, sizeof(countPart));
+
+    if( parts == NULL ) {
+        return false;
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        parts[p].window = window;
+        parts[p].start = window->count * p / numParts;
+        parts[p].end = window->count * ( p + 1 ) / numParts;
+    }
+
+    runParts(countDigits, (char *) parts, sizeof(countPart), numParts);
+
+    for(int p = 0; p < numParts; ++p) {
+        for(int d = 0; d < RADIX_PASSES; ++d) {
+            for(int b = 0; b < RADIX_BUCKETS; ++b) {
+                counts[d][b] += parts[p].counts[d][b];
+            }
+        }
+    }
+
+    free(parts);
+
+    return true;
+}
+
+
+static int recordWords(const radixPass * pass) {
+    return ( pass->indexed && ! pass->last ) ? 2 : 1;
+}
+
+
+static void * countPassDigits(void * arg) {
+
+    scatterPart * part = arg;
+
+    for(size_t i = part->start; i < part->end; ++i) {
+        ++part->counts[digitOf(keyAt(part->window, part->pass->indexed, i), part->pass->digit)];
+    }
+
+    return NULL;
+}
+
+
+static bool flushBucket(scatterPart * part, int bucket) {
+
+    size_t bytes = (size_t) recordWords(part->pass) * sizeof(uint64_t);
+    size_t length = part->filled[bucket] * bytes;
+    const uint64_t * buffered = part->buffer + (size_t) bucket * RADIX_BUFFER * recordWords(part->pass);
+
+    if( pwrite(part->pass->fdOut, buffered, length, part->next[bucket] * bytes) != (ssize_t) length ) {
+        return false;
+    }
+
+    part->next[bucket] += part->filled[bucket];
+    part->filled[bucket] = 0;
+
+    return true;
+}
+
+
+static void * scatterElements(void * arg) {
+
+    scatterPart * part = arg;
+    const radixPass * pass = part->pass;
+    int words = recordWords(pass);
+
+    for(size_t i = part->start; part->ok && i < part->end; ++i) {
+        uint64_t key = keyAt(part->window, pass->indexed, i);
+        int bucket = digitOf(key, pass->digit);
+        uint64_t * slot = part->buffer + ( (size_t) bucket * RADIX_BUFFER + part->filled[bucket] ) * words;
+
+        if( ! pass->last ) {
+            slot[0] = key;
+
+            if( pass->indexed ) {
+                slot[1] = positionAt(part->window, i);
+            }
+        } else {
+            // The result is the sorted values or their one-based positions
+            double result = pass->indexed ? (double) ( positionAt(part->window, i) + 1 ) : keyValue(key);
+            memcpy(slot, &result, sizeof(result));
+        }
+
+        if( ++part->filled[bucket] == RADIX_BUFFER ) {
+            part->ok = flushBucket(part, bucket);
+        }
+    }
+
+    for(int b = 0; part->ok && b < RADIX_BUCKETS; ++b) {
+        if( part->filled[b] > 0 ) {
+            part->ok = flushBucket(part, b);
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Writes a window's elements to their buckets' next positions in the
+ * pass's output and moves those positions on
+ */
+bool radixScatter( const radixWindow * window, radixPass * pass ) {
+
+    int numParts = partsFor(window->count);
+    scatterPart * parts = calloc(numParts, sizeof(scatterPart));
+    bool ok = ( parts != NULL );
+
+    for(int p = 0; ok && p < numParts; ++p) {
+        parts[p].window = window;
+        parts[p].pass = pass;
+        parts[p].start = window->count * p / numParts;
+        parts[p].end = window->count * ( p + 1 ) / numParts;
+        parts[p].buffer = malloc((size_t) RADIX_BUCKETS * RADIX_BUFFER * recordWords(pass) * sizeof(uint64_t));
+        parts[p].ok = true;
+        ok = ( parts[p].buffer != NULL );
+    }
+
+    if( ok ) {
+        runParts(countPassDigits, (char *) parts, sizeof(scatterPart), numParts);
+
+        // Bucket by bucket, earlier parts take the front of each slice
+        for(int b = 0; b < RADIX_BUCKETS; ++b) {
+            for(int p = 0; p < numParts; ++p) {
+                parts[p].next[b] = pass->next[b];
+                pass->next[b] += parts[p].counts[b];
+            }
+        }
+
+        runParts(scatterElements, (char *) parts, sizeof(scatterPart), numParts);
+    }
+
+    for(int p = 0; parts != NULL && p < numParts; ++p) {
+        ok = ok && parts[p].ok;
+        free(parts[p].buffer);
+    }
+
+    free(parts);
+
+    return ok;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file random.c
+ * @brief Counter-based random vector generation
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - Every generated element has its own index in one global sequence
+ *  - Element i is the SplitMix64 finalizer applied to seed + i * gamma, so
+ *    it depends only on the seed and i, never on what produced i - 1
+ *  - Each command takes the next n indices of the sequence (2n for randn)
+ *    as a run, filled in by element index
+ *  - Counts up to MAX_VECTOR_DIMENSION give an ordinary vector, longer
+ *    ones are streamed a window at a time into a file-backed ans
+ *    (mapped.c). Neither depends on the order blocks are filled in
+ *  - So a large fill is split into index ranges, one per thread, and
+ *    gives the same elements whatever the number of threads
+ *    - Each kind has its own branch-free loop over the range. The
+ *      uniform one converts 53 bits to double in two exact halves,
+ *      which the vectorizer handles without 64 bit conversions
+ */
+
+#include "random.h"
+#include "termcolors.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SPLITMIX_GAMMA 0x9E3779B97F4A7C15ULL
+#define TWO_POW_MINUS_53 ( 1.0 / 9007199254740992.0 )
+#define TWO_PI 6.283185307179586
+#define LOW_BITS 26
+#define TWO_POW_26 67108864.0
+
+static uint64_t seed = DEFAULT_RANDOM_SEED;
+static uint64_t counter = 0; // index of the next element to generate
+
+
+void seedRandom( uint64_t newSeed ) {
+    seed = newSeed;
+    counter = 0;
+}
+
+
+typedef struct {
+
+    const randomRun * run;
+    size_t first;
+    double * out;
+    size_t count;
+
+} randomPart;
+
+
+static inline uint64_t mixBits(uint64_t key, uint64_t index) {
+
+    uint64_t z = key + ( index + 1 ) * SPLITMIX_GAMMA;
+
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return z ^ ( z >> 31 );
+}
+
+
+/**
+ * Uniform in [0, 1). The top 53 bits go to double as two halves of at
+ * most 27 bits, each converts exactly, so this is ( bits >> 11 ) * 2^-53
+ */
+static inline double unitOf(uint64_t bits) {
+
+    uint64_t top = bits >> 11;
+    double high = (double) (int32_t) ( top >> LOW_BITS );
+    double low = (double) (int32_t) ( top & ( ( 1ULL << LOW_BITS ) - 1 ) );
+
+    return ( high * TWO_POW_26 + low ) * TWO_POW_MINUS_53;
+}
+
+
+double nextUniform( void ) {
+    return unitOf(mixBits(seed, counter++));
+}
+
+
+/**
+ * Takes the next n elements' worth of the sequence for one command
+ */
+bool startRandomRun( randomRun * run, randomKind kind, double lo, double hi, size_t n ) {
+
+    if( kind == RANDOM_INTEGER ) {
+        // Checked before the cast, converting a value out of range is undefined
+        if( ! isfinite(lo) || ! isfinite(hi) || lo != floor(lo) || hi != floor(hi) || lo > hi ||
+            hi - lo >= 18446744073709551616.0 ) {
+            printMessage(ANSI_COLOR_RED "Bounds must be integers with lo <= hi!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        run->range = (uint64_t) ( hi - lo ) + 1;
+    }
+
+    run->kind = kind;
+    run->seed = seed;
+    run->first = counter;
+    run->lo = lo;
+
+    // Box-Muller draws two uniforms for every normal
+    counter += ( kind == RANDOM_NORMAL ) ? 2 * n : n;
+
+    return true;
+}
+
+
+static void * fillPart(void * arg) {
+
+    const randomPart * part = arg;
+    const randomRun * run = part->run;
+    uint64_t key = run->seed;
+    uint64_t base = run->first + part->first;
+    double * out = part->out;
+    size_t count = part->count;
+
+    switch(run->kind) {
+        case RANDOM_UNIFORM:
+            for(size_t i = 0; i < count; ++i) {
+                out[i] = unitOf(mixBits(key, base + i));
+            }
+            break;
+
+        case RANDOM_NORMAL:
+            // Two indices per element, u1 in (0, 1] so the log is finite
+            base = run->first + 2 * part->first;
+
+            for(size_t i = 0; i < count; ++i) {
+                double u1 = 1.0 - unitOf(mixBits(key, base + 2 * i));
+                double u2 = unitOf(mixBits(key, base + 2 * i + 1));
+
+                out[i] = sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+            }
+            break;
+
+        case RANDOM_INTEGER:
+            // Multiply-shift maps the 64 random bits onto [0, range)
+            for(size_t i = 0; i < count; ++i) {
+                uint64_t bits = mixBits(key, base + i);
+                uint64_t offset = (uint64_t) ( ( (unsigned __int128) bits * run->range ) >> 64 );
+
+                out[i] = run->lo + (double) offset;
+            }
+            break;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Fills out with elements [first, first + count) of the run, split
+ * across threads once there are RANDOM_PARALLEL_MIN of them
+ */
+void fillRandomRun( const randomRun * run, size_t first, double * out, size_t count ) {
+
+    int numParts = 1;
+
+    if( count >= RANDOM_PARALLEL_MIN ) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numParts = ( cpus > MAX_RANDOM_THREADS ) ? MAX_RANDOM_THREADS : ( cpus < 1 ) ? 1 : (int) cpus;
+    }
+
+    randomPart parts[MAX_RANDOM_THREADS];
+    pthread_t threads[MAX_RANDOM_THREADS];
+    bool started[MAX_RANDOM_THREADS] = { false };
+
+    for(int p = 0; p < numParts; ++p) {
+        size_t start = count * p / numParts;
+
+        parts[p] = (randomPart) {
+            .run = run,
+            .first = first + start,
+            .out = out + start,
+            .count = count * ( p + 1 ) / numParts - start,
+        };
+    }
+
+    // The calling thread takes the first part and any a thread was not started for
+    for(int p = 1; p < numParts; ++p) {
+        started[p] = pthread_create(&threads[p], NULL, fillPart, &parts[p]) == 0;
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        if( p == 0 || ! started[p] ) {
+            fillPart(&parts[p]);
+        }
+    }
+
+    for(int p = 1; p < numParts; ++p) {
+        if( started[p] ) {
+            pthread_join(threads[p], NULL);
+        }
+    }
+}
+
+
+// n is checked as a double, the parser leaves it unchecked
+static bool validCount(double n) {
+
+    if( ! ( n >= 1 && n <= MAX_VECTOR_DIMENSION ) || n != floor(n) ) {
+        printMessage(ANSI_COLOR_RED "Vector size is out of range!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    return true;
+}
+
+
+static vector randomVector(randomKind kind, double lo, double hi, double n) {
+
+    vector result = { .vecSize = 0 };
+    randomRun run;
+
+    if( ! validCount(n) || ! startRandomRun(&run, kind, lo, hi, (size_t) n) ) {
+        return result;
+    }
+
+    fillRandomRun(&run, 0, result.magnitudes, (size_t) n);
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = (int) n;
+
+    return result;
+}
+
+
+vector randu( double n ) {
+    return randomVector(RANDOM_UNIFORM, 0.0, 0.0, n);
+}
+
+
+vector randn( double n ) {
+    return randomVector(RANDOM_NORMAL, 0.0, 0.0, n);
+}
+
+
+vector randi( double lo, double hi, double n ) {
+    return randomVector(RANDOM_INTEGER, lo, hi, n);
+}
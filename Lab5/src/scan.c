@@ -0,0 +1,136 @@
+/**
+ * @file scan.c
+ * @brief Parallel two-pass prefix sums and products over a window
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Algorithm:
+ *  - The window is split into one part per thread
+ *  - First pass: every part totals its elements
+ *  - The part totals are scanned on the calling thread, starting from
+ *    the carry left by the windows before
+ *  - Second pass: every part scans its elements in place starting from
+ *    its offset, so each element is read twice and written once
+ *  - The window's last element is carried into the next window
+ */
+
+#include "scan.h"
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct {
+
+    double * values;
+    size_t start;
+    size_t end;
+    bool product;
+    double offset; // total of the part, then the running total before it
+
+} scanPart;
+
+
+static void * totalPart(void * arg) {
+
+    scanPart * part = arg;
+    double total = part->product ? 1.0 : 0.0;
+
+    if( part->product ) {
+        for(size_t i = part->start; i < part->end; ++i) total *= part->values[i];
+    } else {
+        for(size_t i = part->start; i < part->end; ++i) total += part->values[i];
+    }
+
+    part->offset = total;
+
+    return NULL;
+}
+
+
+static void * rescanPart(void * arg) {
+
+    scanPart * part = arg;
+    double running = part->offset;
+
+    if( part->product ) {
+        for(size_t i = part->start; i < part->end; ++i) part->values[i] = running *= part->values[i];
+    } else {
+        for(size_t i = part->start; i < part->end; ++i) part->values[i] = running += part->values[i];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Runs work on every part, the calling thread takes the first and any
+ * part a thread could not be started for
+ */
+static void runParts(void * (*work)(void *), scanPart * parts, int numParts) {
+
+    pthread_t threads[MAX_SCAN_THREADS];
+    bool started[MAX_SCAN_THREADS] = { false };
+
+    for(int p = 1; p < numParts; ++p) {
+        started[p] = pthread_create(&threads[p], NULL, work, &parts[p]) == 0;
+    }
+
+    for(int p = 0; p < numParts; ++p) {
+        if( p == 0 || ! started[p] ) {
+            work(&parts[p]);
+        }
+    }
+
+    for(int p = 1; p < numParts; ++p) {
+        if( started[p] ) {
+            pthread_join(threads[p], NULL);
+        }
+    }
+}
+
+
+/**
+ * Replaces values with their running sums (or products) continuing from
+ * *carry, and leaves the last of them in *carry for the next window
+ */
+void scanWindow( double * values, size_t count, double * carry, bool product ) {
+
+    int numParts = 1;
+
+    if( count >= SCAN_PARALLEL_MIN ) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numParts = ( cpus > MAX_SCAN_THREADS ) ? MAX_SCAN_THREADS : ( cpus < 1 ) ? 1 : (int) cpus;
+    }
+
+    scanPart parts[MAX_SCAN_THREADS];
+
+    for(int p = 0; p < numParts; ++p) {
+        parts[p] = (scanPart) {
+            .values = values,
+            .start = count * p / numParts,
+            .end = count * ( p + 1 ) / numParts,
+            .product = product,
+        };
+    }
+
+    // One part starts straight from the carry, its total is not needed
+    if( numParts > 1 ) {
+        runParts(totalPart, parts, numParts);
+    }
+
+    double running = *carry;
+
+    for(int p = 0; p < numParts; ++p) {
+        double total = parts[p].offset;
+        parts[p].offset = running;
+        running = product ? running * total : running + total;
+    }
+
+    runParts(rescanPart, parts, numParts);
+
+    if( count > 0 ) {
+        *carry = values[count - 1];
+    }
+}
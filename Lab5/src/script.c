@@ -0,0 +1,284 @@
+/**
+ * @file script.c
+ * @brief repeat and for blocks, parsed once and then run as a list of
+ * commands
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - "repeat N" or "for i = from:to" / "for i = from:step:to" opens a
+ *    block, lines up to the matching "end" are its body
+ *  - Each body line is parsed once into a minimatcmd, nested blocks
+ *    become steps of their own
+ *  - Running a block executes the parsed list the given number of times.
+ *    A for loop stores its counter as the one element vector i before
+ *    each pass, commands look it up by name like any other vector
+ */
+
+#include "script.h"
+#include "mapped.h"
+#include "termcolors.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_LINE_LEN ( INPUT_BUFFER_SIZE + 40 )
+
+typedef struct {
+
+    minimatcmd cmd;
+    scriptBlock * block; // nested block, NULL for a plain command
+
+} scriptStep;
+
+struct scriptBlock {
+
+    long long iterations;
+    bool counted; // for loop, stores its counter before each pass
+    char counter[MAX_VECTOR_NAME_LEN];
+    double from;
+    double step;
+
+    scriptStep * steps;
+    int numSteps;
+    int capacity;
+
+};
+
+
+static bool firstWordIs(const char * line, const char * word) {
+
+    size_t len = strlen(word);
+
+    line += strspn(line, " ");
+
+    return strncmp(line, word, len) == 0 && ( line[len] == '\0' || line[len] == ' ' );
+}
+
+
+bool isBlockStart( const char * line ) {
+    return firstWordIs(line, REPEAT_KEYWORD) || firstWordIs(line, FOR_KEYWORD);
+}
+
+
+/**
+ * Reads "repeat N" or "for i = from[:step]:to" into an empty block
+ */
+static bool parseHeader(scriptBlock * block, char * header) {
+
+    char * keyword = strtok(header, " ");
+    char * first = strtok(NULL, " ");
+
+    if( strcmp(keyword, REPEAT_KEYWORD) == 0 ) {
+        char * end;
+        double count = ( first != NULL ) ? strtod(first, &end) : -1;
+
+        if( first == NULL || *end != '\0' || count < 0 || count != floor(count) || strtok(NULL, " ") != NULL ) {
+            printMessage(ANSI_COLOR_RED "ERROR: Expected repeat N" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        block->iterations = (long long) count;
+        return true;
+    }
+
+    char * equals = strtok(NULL, " ");
+    char * range = strtok(NULL, " ");
+    double bounds[3];
+    int numBounds = 0;
+
+    for(char * part = range; part != NULL && numBounds < 3; ++numBounds) {
+        char * end;
+        bounds[numBounds] = strtod(part, &end);
+
+        if( end == part || ( *end != '\0' && *end != RANGE_SEPARATOR ) ) {
+            numBounds = 0;
+            break;
+        }
+
+        part = ( *end == RANGE_SEPARATOR ) ? end + 1 : NULL;
+    }
+
+    if( first == NULL || strlen(first) >= MAX_VECTOR_NAME_LEN || equals == NULL ||
+        strcmp(equals, "=") != 0 || numBounds < 2 || strtok(NULL, " ") != NULL ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Expected for i = from:to or for i = from:step:to" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    double to = bounds[numBounds - 1];
+
+    block->counted = true;
+    strcpy(block->counter, first);
+    block->from = bounds[0];
+    block->step = ( numBounds == 3 ) ? bounds[1] : 1.0;
+
+    // Values run from + k * step, up to and including to when it lands on one
+    double passes = ( block->step == 0.0 ) ? 0.0 : floor(( to - block->from ) / block->step) + 1;
+    block->iterations = ( passes > 0 ) ? (long long) passes : 0;
+
+    return true;
+}
+
+
+static bool appendStep(scriptBlock * block, scriptStep step) {
+
+    if( block->numSteps == block->capacity ) {
+        int capacity = ( block->capacity == 0 ) ? 8 : block->capacity * 2;
+        scriptStep * steps = realloc(block->steps, capacity * sizeof(scriptStep));
+
+        if( steps == NULL ) {
+            printMessage(ANSI_COLOR_RED "Not enough memory for the block" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        block->steps = steps;
+        block->capacity = capacity;
+    }
+
+    block->steps[block->numSteps++] = step;
+
+    return true;
+}
+
+
+/**
+ * Reads past the rest of a rejected block so its body and end are not
+ * run as ordinary commands
+ */
+static void skipBody(FILE * input) {
+
+    char inputBuffer[INPUT_BUFFER_SIZE];
+    int unclosed = 1;
+
+    while( unclosed > 0 && fgets(inputBuffer, sizeof(inputBuffer), input) != NULL ) {
+
+        inputBuffer[strcspn(inputBuffer, "\n")] = '\0';
+
+        if( isBlockStart(inputBuffer) ) {
+            ++unclosed;
+        } else if( firstWordIs(inputBuffer, END_KEYWORD) ) {
+            --unclosed;
+        }
+    }
+}
+
+
+static scriptBlock * failBlock(scriptBlock * block, FILE * input) {
+
+    freeBlock(block);
+    skipBody(input);
+
+    return NULL;
+}
+
+
+static scriptBlock * compileNested(char * header, FILE * input, int depth) {
+
+    scriptBlock * block = calloc(1, sizeof(scriptBlock));
+
+    if( block == NULL || ! parseHeader(block, header) ) {
+        return failBlock(block, input);
+    }
+
+    if( depth >= MAX_BLOCK_DEPTH ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Blocks are nested too deeply" ANSI_COLOR_RESET);
+        return failBlock(block, input);
+    }
+
+    char inputBuffer[INPUT_BUFFER_SIZE];
+
+    while( fgets(inputBuffer, sizeof(inputBuffer), input) != NULL ) {
+
+        inputBuffer[strcspn(inputBuffer, "\n")] = '\0';
+
+        if( inputBuffer[strspn(inputBuffer, " ")] == '\0' ) {
+            continue;
+        }
+
+        if( firstWordIs(inputBuffer, END_KEYWORD) ) {
+            return block;
+        }
+
+        scriptStep step = { .block = NULL };
+
+        if( isBlockStart(inputBuffer) ) {
+            step.block = compileNested(inputBuffer, input, depth + 1);
+
+            // The nested block already read through its own end
+            if( step.block == NULL ) {
+                return failBlock(block, input);
+            }
+        } else {
+            // Parsing splits the buffer up, keep the text for the error
+            char original[INPUT_BUFFER_SIZE];
+            strcpy(original, inputBuffer);
+
+            step.cmd = minimatProcessCmd(&inputBuffer[0]);
+
+            // Caught now rather than once per pass
+            if( step.cmd.operation == CMD_ERROR ) {
+                char line[SCRIPT_LINE_LEN];
+                snprintf(line, sizeof(line), ANSI_COLOR_RED "ERROR: Not a command: %s" ANSI_COLOR_RESET, original);
+                printMessage(line);
+                return failBlock(block, input);
+            }
+        }
+
+        if( ! appendStep(block, step) ) {
+            freeBlock(step.block);
+            return failBlock(block, input);
+        }
+    }
+
+    printMessage(ANSI_COLOR_RED "ERROR: Missing end for the block" ANSI_COLOR_RESET);
+    freeBlock(block);
+
+    return NULL;
+}
+
+
+scriptBlock * compileBlock( char * header, FILE * input ) {
+    return compileNested(header, input, 0);
+}
+
+
+void runBlock( const scriptBlock * block ) {
+
+    for(long long pass = 0; pass < block->iterations; ++pass) {
+
+        if( block->counted ) {
+            vector counter = { .vecSize = 1 };
+            strcpy(counter.vecName, block->counter);
+            counter.magnitudes[0] = block->from + pass * block->step;
+
+            unmapVector(counter.vecName);
+            addVectorToMemoryList(counter);
+        }
+
+        for(int i = 0; i < block->numSteps; ++i) {
+            if( block->steps[i].block != NULL ) {
+                runBlock(block->steps[i].block);
+            } else {
+                minimatExecuteCmd(block->steps[i].cmd);
+            }
+        }
+    }
+}
+
+
+void freeBlock( scriptBlock * block ) {
+
+    if( block == NULL ) {
+        return;
+    }
+
+    for(int i = 0; i < block->numSteps; ++i) {
+        freeBlock(block->steps[i].block);
+    }
+
+    free(block->steps);
+    free(block);
+}
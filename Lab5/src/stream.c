@@ -0,0 +1,420 @@
+/**
+ * @file stream.c
+ * @brief Vectors fed continuously from a file or pipe, with rolling
+ * statistics over their last window samples
+ * 
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ * 
+ * Algorithm:
+ *  - "stream name window source" starts a thread reading whitespace
+ *    separated numbers from the file, FIFO or open descriptor number
+ *  - Samples go into a ring buffer of the window size, the sample
+ *    falling out of the window is removed as the new one is added
+ *    - Sum, mean and variance (Welford) are updated in O(1)
+ *    - Min and max come from monotonic deques of (value, sample number),
+ *      amortized O(1) as each sample enters and leaves once
+ *  - The thread parses a whole read before taking the lock and applying
+ *    it, "stats name" copies the statistics under the same lock, so a
+ *    query always sees the window at one sample boundary
+ *  - A stream is only read through "stats", it is not a vector, and a
+ *    name can't be both (minimat.c refuses either way round)
+ */
+
+#include "stream.h"
+#include "termcolors.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STREAM_LINE_LEN ( MAX_VECTOR_NAME_LEN + 200 )
+// Longest number text carried over between reads
+#define MAX_NUMBER_LEN 64
+
+// Sample and its position in the stream, for the min and max deques
+typedef struct {
+
+    double value;
+    long long index;
+
+} dequeEntry;
+
+// Ring of entries, front is the oldest
+typedef struct {
+
+    dequeEntry * entries;
+    int front;
+    int count;
+
+} monotonicDeque;
+
+typedef struct {
+
+    char vecName[MAX_VECTOR_NAME_LEN];
+    int window;
+    int fd;
+    bool ownsFd; // opened from a path, closed when the stream stops
+
+    pthread_t reader;
+    pthread_mutex_t lock;
+    bool stopping;
+    bool ended; // source reached end of file or failed
+
+    // Everything below changes under lock
+    double * samples; // ring of the last window samples
+    long long total; // samples seen since the stream started
+    int count; // samples in the window
+    double sum;
+    double mean;
+    double m2; // sum of squared distances from the mean
+    monotonicDeque minimum; // increasing values
+    monotonicDeque maximum; // decreasing values
+
+} sampleStream;
+
+static sampleStream * streams[MAX_STREAMS];
+static int numStreams = 0;
+
+
+static dequeEntry * dequeAt(monotonicDeque * deque, int window, int offset) {
+    return &deque->entries[( deque->front + offset ) % window];
+}
+
+
+/**
+ * Adds a sample, dropping entries it makes irrelevant. keepBelow picks a
+ * min deque (back entries >= value go) or a max deque (<= value go)
+ */
+static void dequePush(monotonicDeque * deque, int window, double value, long long index, bool keepBelow) {
+
+    while( deque->count > 0 ) {
+        double back = dequeAt(deque, window, deque->count - 1)->value;
+
+        if( keepBelow ? back < value : back > value ) {
+            break;
+        }
+
+        --deque->count;
+    }
+
+    *dequeAt(deque, window, deque->count++) = ( dequeEntry ) { .value = value, .index = index };
+}
+
+
+static void dequeExpire(monotonicDeque * deque, int window, long long oldest) {
+
+    while( deque->count > 0 && dequeAt(deque, window, 0)->index < oldest ) {
+        deque->front = ( deque->front + 1 ) % window;
+        --deque->count;
+    }
+}
+
+
+static void addSample(sampleStream * s, double value) {
+
+    int slot = (int) ( s->total % s->window );
+
+    // The sample leaving the window comes off first
+    if( s->count == s->window ) {
+        double old = s->samples[slot];
+        double delta = old - s->mean;
+
+        --s->count;
+        s->sum -= old;
+        s->mean = ( s->count > 0 ) ? s->mean - delta / s->count : 0.0;
+        s->m2 = ( s->count > 0 ) ? s->m2 - delta * ( old - s->mean ) : 0.0;
+    }
+
+    double delta = value - s->mean;
+
+    ++s->count;
+    s->sum += value;
+    s->mean += delta / s->count;
+    s->m2 += delta * ( value - s->mean );
+
+    s->samples[slot] = value;
+
+    // Expired entries go before the push so a deque never holds more
+    // than window entries
+    dequeExpire(&s->minimum, s->window, s->total + 1 - s->window);
+    dequeExpire(&s->maximum, s->window, s->total + 1 - s->window);
+
+    dequePush(&s->minimum, s->window, value, s->total, true);
+    dequePush(&s->maximum, s->window, value, s->total, false);
+
+    ++s->total;
+}
+
+
+/**
+ * Waits for input, giving up now and then to check for a stop
+ */
+static ssize_t readSource(sampleStream * s, char * buffer, size_t size) {
+
+    struct pollfd source = { .fd = s->fd, .events = POLLIN };
+
+    while( ! __atomic_load_n(&s->stopping, __ATOMIC_ACQUIRE) ) {
+        int ready = poll(&source, 1, STREAM_POLL_MS);
+
+        if( ready > 0 ) {
+            return read(s->fd, buffer, size);
+        }
+
+        if( ready < 0 ) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void * readerLoop(void * arg) {
+
+    sampleStream * s = arg;
+    char buffer[MAX_NUMBER_LEN + STREAM_READ_BYTES + 1];
+    double * parsed = malloc(( ( MAX_NUMBER_LEN + STREAM_READ_BYTES ) / 2 + 1 ) * sizeof(double));
+    size_t carried = 0; // partial number left from the last read
+    ssize_t got = 1;
+
+    while( parsed != NULL && got > 0 ) {
+
+        got = readSource(s, buffer + carried, STREAM_READ_BYTES);
+        size_t length = carried + ( got > 0 ? got : 0 );
+        buffer[length] = '\0';
+
+        // A number cut off by the end of the read is finished next time,
+        // unless the source has ended
+        size_t usable = length;
+        while( got > 0 && usable > 0 && ! isspace((unsigned char) buffer[usable - 1]) ) {
+            --usable;
+        }
+
+        char saved = buffer[usable];
+        buffer[usable] = '\0';
+
+        int numParsed = 0;
+        char * cursor = buffer;
+
+        for(;;) {
+            char * end;
+            double value = strtod(cursor, &end);
+
+            if( end == cursor ) {
+                // Skip anything that is not a number
+                while( *cursor != '\0' && ! isspace((unsigned char) *cursor) ) ++cursor;
+                while( isspace((unsigned char) *cursor) ) ++cursor;
+
+                if( *cursor == '\0' ) {
+                    break;
+                }
+                continue;
+            }
+
+            parsed[numParsed++] = value;
+            cursor = end;
+        }
+
+        buffer[usable] = saved;
+        carried = length - usable;
+
+        // Too long to be a number, drop it
+        if( carried > MAX_NUMBER_LEN ) {
+            carried = 0;
+        }
+
+        memmove(buffer, buffer + usable, carried);
+
+        pthread_mutex_lock(&s->lock);
+        for(int i = 0; i < numParsed; ++i) {
+            addSample(s, parsed[i]);
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    free(parsed);
+
+    pthread_mutex_lock(&s->lock);
+    s->ended = true;
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+
+static void stopStream(sampleStream * s) {
+
+    __atomic_store_n(&s->stopping, true, __ATOMIC_RELEASE);
+    pthread_join(s->reader, NULL);
+
+    if( s->ownsFd ) {
+        close(s->fd);
+    }
+
+    pthread_mutex_destroy(&s->lock);
+    free(s->samples);
+    free(s->minimum.entries);
+    free(s->maximum.entries);
+    free(s);
+}
+
+
+static int findStream(const char * name) {
+
+    for(int i = 0; i < numStreams; ++i) {
+        if( strcmp(streams[i]->vecName, name) == 0 ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+bool isStream( const char * name ) {
+    return findStream(name) >= 0;
+}
+
+
+/**
+ * Opens "window source" where source is a path or a descriptor number
+ */
+static bool openSource(sampleStream * s, char * args) {
+
+    char * windowText = strtok(args, " ");
+    char * source = strtok(NULL, " ");
+    char * end;
+
+    s->window = ( windowText != NULL ) ? (int) strtol(windowText, &end, 10) : 0;
+
+    if( windowText == NULL || *end != '\0' || s->window < 1 || s->window > MAX_STREAM_WINDOW ||
+        source == NULL || strtok(NULL, " ") != NULL ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Expected stream name window file|fd" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    long fd = strtol(source, &end, 10);
+
+    if( *end == '\0' && fd >= 0 ) {
+        s->fd = (int) fd;
+        s->ownsFd = false;
+    } else {
+        s->fd = open(source, O_RDONLY | O_NONBLOCK);
+        s->ownsFd = true;
+    }
+
+    if( s->fd < 0 || ( ! s->ownsFd && fcntl(s->fd, F_GETFD) < 0 ) ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not open the stream source" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    // Reads wait in poll, a blocking read could not be told to stop
+    if( s->ownsFd ) {
+        fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) & ~O_NONBLOCK);
+    }
+
+    return true;
+}
+
+
+bool openStream( const char * name, const char * args ) {
+
+    char text[strlen(args) + 1];
+    strcpy(text, args);
+
+    sampleStream * s = calloc(1, sizeof(sampleStream));
+
+    if( s == NULL || ! openSource(s, text) ) {
+        free(s);
+        return false;
+    }
+
+    strcpy(s->vecName, name);
+    s->samples = malloc(s->window * sizeof(double));
+    s->minimum.entries = malloc(s->window * sizeof(dequeEntry));
+    s->maximum.entries = malloc(s->window * sizeof(dequeEntry));
+    pthread_mutex_init(&s->lock, NULL);
+
+    int existing = findStream(name);
+
+    if( s->samples == NULL || s->minimum.entries == NULL || s->maximum.entries == NULL ||
+        ( existing < 0 && numStreams == MAX_STREAMS ) ||
+        pthread_create(&s->reader, NULL, readerLoop, s) != 0 ) {
+        printMessage(ANSI_COLOR_RED "ERROR: Could not start the stream" ANSI_COLOR_RESET);
+
+        if( s->ownsFd ) {
+            close(s->fd);
+        }
+
+        pthread_mutex_destroy(&s->lock);
+        free(s->samples);
+        free(s->minimum.entries);
+        free(s->maximum.entries);
+        free(s);
+
+        return false;
+    }
+
+    // Restarting a stream replaces the old one
+    if( existing >= 0 ) {
+        stopStream(streams[existing]);
+        streams[existing] = s;
+    } else {
+        streams[numStreams++] = s;
+    }
+
+    printMessage(ANSI_COLOR_GREEN "Stream started" ANSI_COLOR_RESET);
+
+    return true;
+}
+
+
+bool printStreamStats( const char * name ) {
+
+    int found = findStream(name);
+
+    if( found < 0 ) {
+        printMessage(ANSI_COLOR_RED "Stream does not exist!" ANSI_COLOR_RESET);
+        return false;
+    }
+
+    sampleStream * s = streams[found];
+
+    pthread_mutex_lock(&s->lock);
+
+    long long total = s->total;
+    int count = s->count;
+    double sum = s->sum;
+    double mean = s->mean;
+    // Rounding in the removals can leave m2 a hair under zero
+    double variance = ( count > 1 && s->m2 > 0.0 ) ? s->m2 / ( count - 1 ) : 0.0;
+    double minimum = ( count > 0 ) ? s->minimum.entries[s->minimum.front].value : 0.0;
+    double maximum = ( count > 0 ) ? s->maximum.entries[s->maximum.front].value : 0.0;
+    bool ended = s->ended;
+
+    pthread_mutex_unlock(&s->lock);
+
+    char line[STREAM_LINE_LEN];
+    snprintf(line, sizeof(line), ANSI_COLOR_BLUE "\t%s: %d of %lld samples (%s) sum %f mean %f var %f min %f max %f"
+             ANSI_COLOR_RESET, name, count, total, ended ? "ended" : "live", sum, mean, variance, minimum, maximum);
+    printMessage(line);
+
+    return true;
+}
+
+
+void closeStreams( void ) {
+
+    for(int i = 0; i < numStreams; ++i) {
+        stopStream(streams[i]);
+    }
+
+    numStreams = 0;
+}
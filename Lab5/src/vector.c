@@ -11,29 +11,232 @@
 
 #include "vector.h"
 #include "termcolors.h"
+#include "jit.h"
+#include "kernels.h"
+#include "radix.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
 
-static vector storedVectors[MAX_VECTORS];
-static int headIndex = 0;
+// Returned by operations that could not run, see FAILED_RESULT
+static const vector failedResult = { .vecSize = 0 };
 
+// The workspace the REPL runs in
+static workspace defaultWorkspace = { .slabs = NULL, .output = NULL, .quiet = false };
 
-bool grabVector(vector *a) {
-    
-    bool successfulRetreiveOfVecA = false;
+// Source of vector versions, unique across slots, clears and workspaces so
+// equal versions always mean equal contents
+static uint64_t nextVersion = 1;
+
+// Per thread override of the workspace output, lets a caller capture
+// what one command prints while other threads run theirs
+static _Thread_local FILE * threadOutput = NULL;
+
+// Per thread override of the workspace itself, a background job reads
+// its snapshot while the main thread keeps changing the real one, and
+// library callers on different threads each work in their own
+static _Thread_local workspace * threadWorkspace = NULL;
 
-    for(int i = 0; i < MAX_VECTORS; ++i) {
-        
-        char * tableVecName = storedVectors[i].vecName;
 
-        if( strcmp(tableVecName, a->vecName ) == 0 ) {
-            *a = storedVectors[i];
-            successfulRetreiveOfVecA = true;
+workspace * createWorkspace( void ) {
+
+    return calloc(1, sizeof(workspace));
+}
+
+
+void destroyWorkspace( workspace * ws ) {
+
+    if( ws == NULL || ws == &defaultWorkspace ) {
+        return;
+    }
+
+    for(int i = 0; i < ws->numSlabs; ++i) {
+        free(ws->slabs[i]);
+    }
+
+    free(ws->slabs);
+    free(ws);
+}
+
+
+void setThreadOutput( FILE * out ) {
+    threadOutput = out;
+}
+
+
+/**
+ * Makes this thread work in ws, NULL goes back to the REPL's workspace.
+ * Returns the override it replaced so callers can restore it
+ */
+workspace * setThreadWorkspace( workspace * ws ) {
+
+    workspace * previous = threadWorkspace;
+    threadWorkspace = ws;
+
+    return previous;
+}
+
+
+static workspace * currentWorkspace( void ) {
+    return ( threadWorkspace != NULL ) ? threadWorkspace : &defaultWorkspace;
+}
+
+
+static FILE * workspaceOutput( void ) {
+
+    workspace * ws = currentWorkspace();
+
+    if( ws->quiet ) {
+        return NULL;
+    }
+
+    if( threadOutput != NULL ) {
+        return threadOutput;
+    }
+
+    return ( ws->output != NULL ) ? ws->output : stdout;
+}
+
+
+void printMessage( const char * msg ) {
+
+    FILE * out = workspaceOutput();
+
+    if( out != NULL ) {
+        fputs(msg, out);
+        fputc('\n', out);
+    }
+}
+
+
+static vector * slotVector(workspace * ws, uint32_t index) {
+    return &ws->slabs[index / VECTORS_PER_SLAB]->vectors[index % VECTORS_PER_SLAB];
+}
+
+
+static uint32_t * slotGeneration(workspace * ws, uint32_t index) {
+    return &ws->slabs[index / VECTORS_PER_SLAB]->generations[index % VECTORS_PER_SLAB];
+}
+
+
+static uint64_t * slotVersion(workspace * ws, uint32_t index) {
+    return &ws->slabs[index / VECTORS_PER_SLAB]->versions[index % VECTORS_PER_SLAB];
+}
+
+
+// Every store or in-place update gives the slot a fresh version
+static void stampVersion(workspace * ws, uint32_t index) {
+    *slotVersion(ws, index) = __atomic_fetch_add(&nextVersion, 1, __ATOMIC_RELAXED);
+}
+
+
+uint64_t vectorVersion( vectorHandle handle ) {
+    return *slotVersion(currentWorkspace(), handle.index);
+}
+
+
+int numStoredVectors( void ) {
+    return currentWorkspace()->numVectors;
+}
+
+
+vector * storedVectorAt( int index ) {
+    return slotVector(currentWorkspace(), index);
+}
+
+
+void printStoredVectors( void ) {
+
+    char line[MAX_VECTOR_NAME_LEN + 64];
+    workspace * ws = currentWorkspace();
+
+    for(int i = 0; i < ws->numVectors; ++i) {
+        const vector * v = slotVector(ws, i);
+
+        snprintf(line, sizeof(line), "\t%-16s %12d  %-10s %12zu", v->vecName, v->vecSize,
+                 "memory", v->vecSize * sizeof(double));
+        printMessage(line);
+    }
+}
+
+
+bool findVector( const char * name, vectorHandle * handle ) {
+
+    workspace * ws = currentWorkspace();
+
+    for(int i = 0; i < ws->numVectors; ++i) {
+
+        if( strcmp(slotVector(ws, i)->vecName, name) == 0 ) {
+            handle->index = i;
+            handle->generation = *slotGeneration(ws, i);
+            return true;
         }
 
     }
 
-    return successfulRetreiveOfVecA;
+    return false;
+}
+
+
+vector * vectorFromHandle( vectorHandle handle ) {
+
+    workspace * ws = currentWorkspace();
+
+    // Slots past numVectors or from before a clear are not this vector
+    if( handle.index >= (uint32_t) ws->numVectors ||
+        *slotGeneration(ws, handle.index) != handle.generation ) {
+        return NULL;
+    }
+
+    return slotVector(ws, handle.index);
+}
+
+
+/**
+ * Takes the next slot, adding a slab when the current ones are full
+ */
+static vector * allocateSlot( void ) {
+
+    workspace * ws = currentWorkspace();
+
+    if( ws->numVectors == ws->numSlabs * VECTORS_PER_SLAB ) {
+
+        vectorSlab ** slabs = realloc(ws->slabs, ( ws->numSlabs + 1 ) * sizeof(vectorSlab *));
+
+        if( slabs == NULL ) {
+            return NULL;
+        }
+
+        ws->slabs = slabs;
+        ws->slabs[ws->numSlabs] = malloc(sizeof(vectorSlab));
+
+        if( ws->slabs[ws->numSlabs] == NULL ) {
+            return NULL;
+        }
+
+        ++ws->numSlabs;
+    }
+
+    uint32_t index = ws->numVectors++;
+    *slotGeneration(ws, index) = ws->generation;
+
+    return slotVector(ws, index);
+}
+
+
+bool grabVector(vector *a) {
+    
+    vectorHandle handle;
+
+    if( ! findVector(a->vecName, &handle) ) {
+        return false;
+    }
+
+    *a = *vectorFromHandle(handle);
+
+    return true;
 }
 
 
@@ -57,61 +260,83 @@ void copyVectorKeepName( vector *src, vector *dst ) {
 
 void printVector( vector toPrint ) {
 
-    printf(ANSI_COLOR_BLUE);
+    FILE * out = workspaceOutput();
+
+    if( out == NULL ) {
+        return;
+    }
+
+    // Format for each size, printf ignores the magnitudes it does not use
+    static const char * vectorFormats[MAX_VECTOR_DIMENSION + 1] = {
+        [1] = "\t%s = %f\n",
+        [2] = "\t%s = %f %f\n",
+        [3] = "\t%s = %f %f %f\n",
+    };
 
-    switch(toPrint.vecSize) {
-        case 3:
-            printf("\t%s = %f %f %f\n", toPrint.vecName, \
-            toPrint.magnitudes[0], \
-            toPrint.magnitudes[1], \
-            toPrint.magnitudes[2]);
-            break;
+    fprintf(out, ANSI_COLOR_BLUE);
 
-        case 2:
-            printf("\t%s = %f %f\n", toPrint.vecName, \
-            toPrint.magnitudes[0], \
-            toPrint.magnitudes[1]); \
-            break;
+    // Sizes outside the table, a failed result or a corrupt one, print nothing
+    if( toPrint.vecSize >= 1 && toPrint.vecSize <= MAX_VECTOR_DIMENSION ) {
+        double m[MAX_VECTOR_DIMENSION] = { 0 };
+        memcpy(m, toPrint.magnitudes, toPrint.vecSize * sizeof(double));
 
-        case 1:
-            printf("\t%s = %f\n", toPrint.vecName, \
-            toPrint.magnitudes[0]); \
-            break;
+        fprintf(out, vectorFormats[toPrint.vecSize], toPrint.vecName, m[0], m[1], m[2]);
     }
 
-    printf(ANSI_COLOR_RESET);
+    fprintf(out, ANSI_COLOR_RESET);
 }
 
 
 void clearVectors( void ) {
-    
-    for( int i = 0; i < MAX_VECTORS; ++i ) {
-        volatile vector emptyVector = {0};
 
-        storedVectors[i] = emptyVector;
-    }
+    // Slabs stay allocated for reuse, the bumped generation makes every
+    // outstanding handle stale
+    workspace * ws = currentWorkspace();
 
+    ++ws->generation;
+    ws->numVectors = 0;
 }
 
 
-void addVectorToMemoryList( vector toAdd ) {
+bool addVectorToMemoryList( vector toAdd ) {
+
+    workspace * ws = currentWorkspace();
+    vectorHandle handle;
 
-    bool vectorReplaced = false;
+    // if the vector stored has the same name replace it
+    if( ! findVector(toAdd.vecName, &handle) ) {
 
-    for(int i = 0; i < MAX_VECTORS; ++i) {
-        
-        // if the vector stored has the same name replace it
-        if( strcmp(storedVectors[i].vecName, toAdd.vecName) == 0 ) {
-            storedVectors[i] = toAdd;
-            vectorReplaced = true;
-            break;
+        if( allocateSlot() == NULL ) {
+            printMessage(ANSI_COLOR_RED "Vector memory is full!" ANSI_COLOR_RESET);
+            return false;
         }
 
+        handle.index = ws->numVectors - 1;
     }
 
-    if( ! vectorReplaced ) {
-        storedVectors[headIndex++] = toAdd;
+    *slotVector(ws, handle.index) = toAdd;
+    stampVersion(ws, handle.index);
+
+    return true;
+}
+
+
+void removeVector( const char * name ) {
+
+    workspace * ws = currentWorkspace();
+    vectorHandle handle;
+
+    if( ! findVector(name, &handle) ) {
+        return;
     }
+
+    // The last vector moves into the gap, keeping its version so cached
+    // results that read it stay valid
+    uint32_t last = --ws->numVectors;
+
+    *slotVector(ws, handle.index) = *slotVector(ws, last);
+    *slotGeneration(ws, handle.index) = *slotGeneration(ws, last);
+    *slotVersion(ws, handle.index) = *slotVersion(ws, last);
 }
 
 
@@ -119,21 +344,25 @@ vector add(vector a, vector b) {
 
     // Check vectors exist in memory and retrieve them
     if( ! grabVectors(&a, &b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
     }
 
     // Check dimensons
     if( ! SAME_DIMENSIONS(a, b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
     }
     
     vector result;
+    jitKernel kernel = jitLookup(JIT_ADD, a.vecSize);
 
-    for(int i = 0; i < a.vecSize; ++i) {
-        result.magnitudes[i] = a.magnitudes[i] + b.magnitudes[i];
+    // Native code if compiled, otherwise the unrolled kernel for this size
+    if( kernel == NULL ) {
+        kernel = addKernels[a.vecSize];
     }
+
+    kernel(a.magnitudes, b.magnitudes, result.magnitudes);
     
     strcpy(result.vecName, "ans");
     result.vecSize = a.vecSize;
@@ -146,20 +375,24 @@ vector sub(vector a, vector b) {
 
     // Check vectors exist in memory and retrieve them
     if( ! grabVectors(&a, &b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
     }
 
     if( ! SAME_DIMENSIONS(a, b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
     }
     
     vector result;
+    jitKernel kernel = jitLookup(JIT_SUB, a.vecSize);
 
-    for(int i = 0; i < a.vecSize; ++i) {
-        result.magnitudes[i] = a.magnitudes[i] - b.magnitudes[i];
+    // Native code if compiled, otherwise the unrolled kernel for this size
+    if( kernel == NULL ) {
+        kernel = subKernels[a.vecSize];
     }
+
+    kernel(a.magnitudes, b.magnitudes, result.magnitudes);
     
     strcpy(result.vecName, "ans");
     result.vecSize = a.vecSize;
@@ -171,20 +404,16 @@ vector sub(vector a, vector b) {
 vector dotprod(vector a, vector b) {
     
     if( ! grabVectors(&a, &b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
     }
 
     if( ! SAME_DIMENSIONS(a, b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
     }
     
-    double sum = 0.0f;
-
-    for(int i = 0; i < a.vecSize; ++i) {
-        sum += a.magnitudes[i] * b.magnitudes[i];
-    }
+    double sum = dotKernels[a.vecSize](a.magnitudes, b.magnitudes);
 
     vector ans;
     strcpy(ans.vecName, "ans");
@@ -198,14 +427,18 @@ vector dotprod(vector a, vector b) {
 vector scalarmul(vector a, double b) {
 
     if( ! grabVector(&a) ) {
-        puts("Vector does not exist!");
-        return a;
+        printMessage("Vector does not exist!");
+        return failedResult;
     }
 
-    for(int i = 0; i < a.vecSize; ++i) {
-        a.magnitudes[i] *= b;
+    jitKernel kernel = jitLookup(JIT_SCALE, a.vecSize);
+
+    if( kernel == NULL ) {
+        kernel = scaleKernels[a.vecSize];
     }
 
+    kernel(a.magnitudes, &b, a.magnitudes);
+
     return a;
 }
 
@@ -213,14 +446,14 @@ vector scalarmul(vector a, double b) {
 vector xprod(vector a, vector b) {
 
     if( ! grabVectors(&a, &b) ) {
-        puts(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
     }
 
 
     if( ! SAME_DIMENSIONS(a, b) || a.vecSize != 3) {
-        puts(ANSI_COLOR_RED "Vectors do not have proper dimension!" ANSI_COLOR_RESET);
-        return a;
+        printMessage(ANSI_COLOR_RED "Vectors do not have proper dimension!" ANSI_COLOR_RESET);
+        return failedResult;
     }
 
     vector c;
@@ -239,4 +472,442 @@ vector xprod(vector a, vector b) {
     c.vecSize = 3;
 
     return c;
-}
\ No newline at end of file
+}
+
+
+/**
+ * Stable insertion sort of the element positions of a by key. Vectors in
+ * memory are at most MAX_VECTOR_DIMENSION long so this beats any bucketed
+ * sort, file-backed ones are radix sorted on the same keys (radix.c).
+ */
+static void sortedOrder(vector *a, int order[MAX_VECTOR_DIMENSION]) {
+
+    uint64_t keys[MAX_VECTOR_DIMENSION];
+
+    for(int i = 0; i < a->vecSize; ++i) {
+        keys[i] = orderedKey(a->magnitudes[i]);
+        order[i] = i;
+    }
+
+    for(int i = 1; i < a->vecSize; ++i) {
+        uint64_t key = keys[i];
+        int pos = order[i];
+        int j = i - 1;
+
+        while( j >= 0 && keys[j] > key ) {
+            keys[j + 1] = keys[j];
+            order[j + 1] = order[j];
+            --j;
+        }
+
+        keys[j + 1] = key;
+        order[j + 1] = pos;
+    }
+}
+
+
+vector sort(vector a) {
+
+    if( ! grabVector(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    int order[MAX_VECTOR_DIMENSION];
+    sortedOrder(&a, order);
+
+    vector result;
+
+    for(int i = 0; i < a.vecSize; ++i) {
+        result.magnitudes[i] = a.magnitudes[order[i]];
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+vector argsort(vector a) {
+
+    if( ! grabVector(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    int order[MAX_VECTOR_DIMENSION];
+    sortedOrder(&a, order);
+
+    vector result;
+
+    // Indices are one-based on purpose: they are positions as a user
+    // counts them, and x[i], gather and scatter take the same convention,
+    // so "argsort x" then "x[ans]" is x sorted
+    for(int i = 0; i < a.vecSize; ++i) {
+        result.magnitudes[i] = order[i] + 1;
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+vector cumsum(vector a) {
+
+    if( ! grabVector(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+    double running = 0.0;
+
+    for(int i = 0; i < a.vecSize; ++i) {
+        running += a.magnitudes[i];
+        result.magnitudes[i] = running;
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+vector cumprod(vector a) {
+
+    if( ! grabVector(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+    double running = 1.0;
+
+    for(int i = 0; i < a.vecSize; ++i) {
+        running *= a.magnitudes[i];
+        result.magnitudes[i] = running;
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+vector elementwise(vector a, double (*fn)(double)) {
+
+    if( ! grabVector(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+
+    for(int i = 0; i < a.vecSize; ++i) {
+        result.magnitudes[i] = fn(a.magnitudes[i]);
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+/**
+ * Operands left unnamed are literals the parser already filled in
+ */
+static bool grabOperand(vector *a) {
+    return a->vecName[0] == '\0' || grabVector(a);
+}
+
+
+// A one element operand stands for that value at every position
+static double broadcastAt(const vector *v, int i) {
+    return v->magnitudes[( v->vecSize == 1 ) ? 0 : i];
+}
+
+
+static bool broadcastable(vector a, vector b) {
+    return SAME_DIMENSIONS(a, b) || b.vecSize == 1;
+}
+
+
+vector compare(vector a, vector b, char relation) {
+
+    if( ! grabOperand(&a) || ! grabOperand(&b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! broadcastable(a, b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+
+    // Masks hold 1 where the relation holds and 0 elsewhere
+    for(int i = 0; i < a.vecSize; ++i) {
+        double rhs = broadcastAt(&b, i);
+        result.magnitudes[i] = ( relation == '>' ) ? a.magnitudes[i] > rhs : a.magnitudes[i] < rhs;
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = a.vecSize;
+
+    return result;
+}
+
+
+vector where(vector mask, vector a, vector b) {
+
+    if( ! grabVector(&mask) || ! grabOperand(&a) || ! grabOperand(&b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! broadcastable(mask, a) || ! broadcastable(mask, b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+
+    for(int i = 0; i < mask.vecSize; ++i) {
+        result.magnitudes[i] = ( mask.magnitudes[i] != 0 ) ? broadcastAt(&a, i) : broadcastAt(&b, i);
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = mask.vecSize;
+
+    return result;
+}
+
+
+vector selectWhere(vector mask, vector a) {
+
+    vector zero = { .vecName = "", .vecSize = 1 };
+
+    return where(mask, a, zero);
+}
+
+
+vector compressWhere(vector mask, vector a) {
+
+    if( ! grabVector(&mask) || ! grabOperand(&a) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! SAME_DIMENSIONS(mask, a) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    vector result;
+    int kept = 0;
+
+    for(int i = 0; i < a.vecSize; ++i) {
+        result.magnitudes[kept] = a.magnitudes[i];
+        kept += ( mask.magnitudes[i] != 0 );
+    }
+
+    if( kept == 0 ) {
+        printMessage(ANSI_COLOR_RED "The mask selects no elements!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = kept;
+
+    return result;
+}
+
+
+/**
+ * Converts one-based indices to positions in a vector of the given size
+ */
+static bool indexPositions(const vector *idx, int size, int positions[]) {
+
+    for(int i = 0; i < idx->vecSize; ++i) {
+        double index = idx->magnitudes[i];
+
+        // Range checked before the cast, converting one out of range is undefined
+        if( ! ( index >= 1 && index <= size ) || index != floor(index) ) {
+            printMessage(ANSI_COLOR_RED "Index out of range!" ANSI_COLOR_RESET);
+            return false;
+        }
+
+        positions[i] = (int) index - 1;
+    }
+
+    return true;
+}
+
+
+vector gather(vector a, vector idx) {
+
+    int positions[MAX_VECTOR_DIMENSION];
+
+    if( ! grabVector(&a) || ! grabOperand(&idx) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! indexPositions(&idx, a.vecSize, positions) ) {
+        return failedResult;
+    }
+
+    vector result;
+
+    for(int i = 0; i < idx.vecSize; ++i) {
+        result.magnitudes[i] = a.magnitudes[positions[i]];
+    }
+
+    strcpy(result.vecName, "ans");
+    result.vecSize = idx.vecSize;
+
+    return result;
+}
+
+
+vector scatter(vector a, vector idx, vector b) {
+
+    int positions[MAX_VECTOR_DIMENSION];
+
+    if( ! grabVector(&a) || ! grabOperand(&idx) || ! grabOperand(&b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! broadcastable(idx, b) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! indexPositions(&idx, a.vecSize, positions) ) {
+        return failedResult;
+    }
+
+    // The result replaces a, so it keeps a's name
+    for(int i = 0; i < idx.vecSize; ++i) {
+        a.magnitudes[positions[i]] = broadcastAt(&b, i);
+    }
+
+    return a;
+}
+
+
+/**
+ * Finds the stored vector an in-place update rewrites
+ */
+static vector * updateTarget(const char * name, vectorHandle * handle) {
+
+    if( ! findVector(name, handle) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return NULL;
+    }
+
+    return vectorFromHandle(*handle);
+}
+
+
+vector axpyInPlace( const char * name, double scalar, vector x ) {
+
+    vectorHandle handle;
+    vector * y = updateTarget(name, &handle);
+
+    if( y == NULL ) {
+        return failedResult;
+    }
+
+    // x is copied out first, so "a += a" reads the old a
+    if( ! grabOperand(&x) ) {
+        printMessage(ANSI_COLOR_RED "Vector does not exist!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    if( ! broadcastable(*y, x) ) {
+        printMessage(ANSI_COLOR_RED "Vectors do not have same dimension!" ANSI_COLOR_RESET);
+        return failedResult;
+    }
+
+    for(int i = x.vecSize; i < y->vecSize; ++i) {
+        x.magnitudes[i] = x.magnitudes[0];
+    }
+
+    // Plain += and -= are the add and sub kernels with the output aliased
+    // to the first input, so they use the JIT code as well
+    jitKernel kernel = NULL;
+
+    if( scalar == 1.0 || scalar == -1.0 ) {
+        kernel = jitLookup(( scalar == 1.0 ) ? JIT_ADD : JIT_SUB, y->vecSize);
+
+        if( kernel == NULL ) {
+            kernel = ( scalar == 1.0 ) ? addKernels[y->vecSize] : subKernels[y->vecSize];
+        }
+
+        kernel(y->magnitudes, x.magnitudes, y->magnitudes);
+    } else {
+        axpyKernels[y->vecSize](x.magnitudes, &scalar, y->magnitudes);
+    }
+
+    stampVersion(currentWorkspace(), handle.index);
+
+    return *y;
+}
+
+
+vector scaleInPlace( const char * name, double scalar ) {
+
+    vectorHandle handle;
+    vector * y = updateTarget(name, &handle);
+
+    if( y == NULL ) {
+        return failedResult;
+    }
+
+    jitKernel kernel = jitLookup(JIT_SCALE, y->vecSize);
+
+    if( kernel == NULL ) {
+        kernel = scaleKernels[y->vecSize];
+    }
+
+    kernel(y->magnitudes, &scalar, y->magnitudes);
+    stampVersion(currentWorkspace(), handle.index);
+
+    return *y;
+}
+
+
+workspace * snapshotVectors( const char * const * names, int count ) {
+
+    workspace * snapshot = createWorkspace();
+
+    if( snapshot == NULL ) {
+        return NULL;
+    }
+
+    for(int i = 0; i < count; ++i) {
+        vector copy;
+        snprintf(copy.vecName, MAX_VECTOR_NAME_LEN, "%s", names[i]);
+
+        // Missing names stay missing and the job reports them itself
+        if( ! grabVector(&copy) ) {
+            continue;
+        }
+
+        workspace * previous = threadWorkspace;
+        threadWorkspace = snapshot;
+        addVectorToMemoryList(copy);
+        threadWorkspace = previous;
+    }
+
+    return snapshot;
+}
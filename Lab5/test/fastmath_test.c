@@ -0,0 +1,217 @@
+/**
+ * @file fastmath_test.c
+ * @brief Checks the fastmath functions against libm, within the ULP
+ * bounds fastmath.h states
+ *
+ * Course: CPE2600
+ * Section: 011
+ * Assignment: Lab 5 - Vector Lab
+ * Name: Matt Korfhage
+ *
+ * Algorithm:
+ *  - Every function runs over random inputs spread across the range it
+ *    computes itself, on a log scale as well as a linear one, plus the
+ *    inputs known to be hard for it
+ *  - The distance to libm is counted in representable doubles between
+ *    the two results, and the worst of it must be within the bound
+ *  - Inputs libm takes over (NaN, infinities, out of range) must match
+ *    libm exactly, and the functions must work in place
+ */
+
+#include "fastmath.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SAMPLES 2000000
+#define HARD_SAMPLES 40000
+#define SIGN_BIT 0x8000000000000000ULL
+
+typedef struct {
+
+    const char * name;
+    arrayFn fast;
+    double (*libm)(double);
+    int bound;
+    double lo; // range of the linear samples
+    double hi;
+
+} mathCase;
+
+static uint64_t state = 0x5EED;
+
+
+static uint64_t nextBits(void) {
+
+    uint64_t z = ( state += 0x9E3779B97F4A7C15ULL );
+
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return z ^ ( z >> 31 );
+}
+
+
+static double nextUnit(void) {
+    return ( nextBits() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+
+// Doubles in integer order, so neighbours differ by one
+static int64_t orderedBits(double d) {
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+
+    return ( bits & SIGN_BIT ) ? -(int64_t) ( bits & ~SIGN_BIT ) : (int64_t) bits;
+}
+
+
+static uint64_t ulpDistance(double a, double b) {
+
+    if( isnan(a) || isnan(b) ) {
+        return ( isnan(a) && isnan(b) ) ? 0 : UINT64_MAX;
+    }
+
+    int64_t d = orderedBits(a) - orderedBits(b);
+
+    return ( d < 0 ) ? (uint64_t) -d : (uint64_t) d;
+}
+
+
+/**
+ * Linear samples over [lo, hi], then magnitudes from 2^-40 up to hi on a
+ * log scale with either sign, then the case's hard inputs
+ */
+static size_t fillInputs(const mathCase * c, double * x, size_t n) {
+
+    size_t count = 0;
+
+    for(size_t i = 0; i < n / 2; ++i) {
+        x[count++] = c->lo + ( c->hi - c->lo ) * nextUnit();
+    }
+
+    double top = log2(fmax(fabs(c->lo), fabs(c->hi)));
+
+    for(size_t i = 0; i < n / 2; ++i) {
+        double magnitude = exp2(-40.0 + ( top + 40.0 ) * nextUnit());
+        x[count++] = ( c->lo < 0 && ( nextBits() & 1 ) ) ? -magnitude : magnitude;
+    }
+
+    // Near multiples of pi/2 the reduced argument cancels the most
+    if( c->libm == sin || c->libm == cos ) {
+        for(int k = 1; k < HARD_SAMPLES; ++k) {
+            x[count++] = k * M_PI_2;
+        }
+    }
+
+    // log is least accurate for m near 1, where e is small
+    if( c->libm == log ) {
+        for(int i = 0; i < HARD_SAMPLES; ++i) {
+            x[count++] = 1.0 + ( nextUnit() - 0.5 ) * 0.6;
+        }
+    }
+
+    // Subnormals, one, values just either side of the cutoffs
+    x[count++] = 0.0;
+    x[count++] = -0.0;
+    x[count++] = 1.0;
+    x[count++] = 4.9e-324;
+    x[count++] = c->lo;
+    x[count++] = c->hi;
+    x[count++] = nextafter(c->hi, 0);
+
+    return count;
+}
+
+
+static bool checkCase(const mathCase * c) {
+
+    size_t capacity = TEST_SAMPLES + HARD_SAMPLES + 16;
+    double * x = malloc(capacity * sizeof(double));
+    double * fast = malloc(capacity * sizeof(double));
+    bool ok = ( x != NULL && fast != NULL );
+
+    if( ! ok ) {
+        printf("%-5s out of memory\n", c->name);
+        free(x);
+        free(fast);
+        return false;
+    }
+
+    size_t n = fillInputs(c, x, TEST_SAMPLES);
+    c->fast(x, fast, n);
+
+    uint64_t worst = 0;
+    double worstAt = 0.0;
+
+    for(size_t i = 0; i < n; ++i) {
+        uint64_t d = ulpDistance(fast[i], c->libm(x[i]));
+
+        if( d > worst ) {
+            worst = d;
+            worstAt = x[i];
+        }
+    }
+
+    ok = ( worst <= (uint64_t) c->bound );
+
+    printf("%-5s worst %llu ulp (bound %d) at %.17g %s\n", c->name, (unsigned long long) worst,
+           c->bound, worstAt, ok ? "ok" : "FAILED");
+
+    // libm's inputs come back exactly as libm gives them
+    double special[] = { NAN, INFINITY, -INFINITY, 1e300, -1e300, 5e-324, -1.0, 1e6 };
+    size_t numSpecial = sizeof(special) / sizeof(special[0]);
+
+    c->fast(special, fast, numSpecial);
+
+    for(size_t i = 0; i < numSpecial; ++i) {
+        double expected = c->libm(special[i]);
+
+        if( ulpDistance(fast[i], expected) > (uint64_t) c->bound ) {
+            printf("%-5s %g gave %g, libm %g FAILED\n", c->name, special[i], fast[i], expected);
+            ok = false;
+        }
+    }
+
+    // In place, over more than one block
+    memcpy(fast, x, n * sizeof(double));
+    c->fast(fast, fast, n);
+
+    for(size_t i = 0; ok && i < n; ++i) {
+        if( ulpDistance(fast[i], c->libm(x[i])) > (uint64_t) c->bound ) {
+            printf("%-5s in place differs at %.17g FAILED\n", c->name, x[i]);
+            ok = false;
+        }
+    }
+
+    free(x);
+    free(fast);
+
+    return ok;
+}
+
+
+int main(void) {
+
+    const mathCase cases[] = {
+        { "sqrt", fastSqrt, sqrt, FAST_SQRT_ULP, 0.0, 1e300 },
+        { "abs",  fastAbs,  fabs, FAST_ABS_ULP, -1e300, 1e300 },
+        { "exp",  fastExp,  exp,  FAST_EXP_ULP, -708.0, 709.0 },
+        { "log",  fastLog,  log,  FAST_LOG_ULP, 0.0, 1e300 },
+        { "sin",  fastSin,  sin,  FAST_SIN_ULP, -FAST_TRIG_MAX, FAST_TRIG_MAX },
+        { "cos",  fastCos,  cos,  FAST_COS_ULP, -FAST_TRIG_MAX, FAST_TRIG_MAX },
+        { "tanh", fastTanh, tanh, FAST_TANH_ULP, -25.0, 25.0 },
+    };
+
+    bool ok = true;
+
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        ok = checkCase(&cases[i]) && ok;
+    }
+
+    return ok ? 0 : 1;
+}